@@ -250,13 +250,17 @@ int	nchars;
     }
     if ((l = (Line *) ralloc()) == NULL) {
 	free(ltp);
-	return NULL;
+	return(NULL);
     }
     ltp[0] = '\0';
     l->l_text = ltp;
     l->l_size = nchars;
     l->l_prev = NULL;
     l->l_next = NULL;
+    l->l_version = 0;
+    l->l_cells = NULL;
+    l->l_cols = NULL;
+    l->l_tnext = l->l_tprev = NULL;
 
     return(l);
 }
@@ -272,16 +276,106 @@ char *str;
     register Line	*l;
 
     if ((l = (Line *) ralloc()) == NULL) {
-	return NULL;
+	return(NULL);
     }
     l->l_text = str;
     l->l_size = strlen(str) + 1;
     l->l_prev = NULL;
     l->l_next = NULL;
+    l->l_version = 0;
+    l->l_cells = NULL;
+    l->l_cols = NULL;
+    l->l_tnext = l->l_tprev = NULL;
+
+    return(l);
+}
+
+/*
+ * Lines may share their text, so that copying lines (as yanking and
+ * putting do) needn't copy what is in them. Lines which share the same
+ * text are kept in a ring through l_tnext and l_tprev, which are NULL
+ * for a line whose text is its own; the text is freed when the last of
+ * them goes. Before a line's text is changed, own_text() must be called
+ * to give it a copy of its own; _replchars() and lnresize() do this.
+ */
+
+/*
+ * twinline(): allocate a new line object which shares the text
+ * of the given one. Returns NULL if there is no memory.
+ */
+Line *
+twinline(src)
+Line	*src;
+{
+    register Line	*l;
+
+    if ((l = (Line *) ralloc()) == NULL) {
+	return(NULL);
+    }
+    l->l_text = src->l_text;
+    l->l_size = src->l_size;
+    l->l_prev = NULL;
+    l->l_next = NULL;
+    l->l_version = 0;
+    l->l_cells = NULL;
+    l->l_cols = NULL;
+
+    if (src->l_tnext == NULL) {
+	src->l_tnext = src->l_tprev = src;
+    }
+    l->l_tnext = src->l_tnext;
+    l->l_tprev = src;
+    src->l_tnext->l_tprev = l;
+    src->l_tnext = l;
 
     return(l);
 }
 
+/*
+ * Take the given line out of the ring of lines sharing its text.
+ * A line left on its own has the text to itself.
+ */
+static void
+untwin(lp)
+Line	*lp;
+{
+    Line	*next = lp->l_tnext;
+
+    if (next->l_tnext == lp) {
+	next->l_tnext = next->l_tprev = NULL;
+    } else {
+	next->l_tprev = lp->l_tprev;
+	lp->l_tprev->l_tnext = next;
+    }
+    lp->l_tnext = lp->l_tprev = NULL;
+}
+
+/*
+ * Make sure that the given line's text is its own, copying it if it
+ * is shared with any other line. Returns FALSE if there is no memory.
+ */
+bool_t
+own_text(lp)
+Line	*lp;
+{
+    char	*text;
+    int		size;
+
+    if (lp->l_tnext == NULL) {
+	return(TRUE);
+    }
+    size = MC_ROUNDUP(strlen(lp->l_text) + 1);
+    text = alloc((unsigned) size);
+    if (text == NULL) {
+	return(FALSE);
+    }
+    (void) strcpy(text, lp->l_text);
+    untwin(lp);
+    lp->l_text = text;
+    lp->l_size = size;
+    return(TRUE);
+}
+
 /*
  * bufempty() - return TRUE if the current buffer is empty
  */
@@ -322,6 +416,9 @@ register unsigned	newsize;
     register char	*newtext;
     register unsigned	oldsize;
 
+    if (!own_text(lp)) {
+	return(FALSE);
+    }
     oldsize = (unsigned) lp->l_size;
 
     if ((newsize = MC_ROUNDUP(newsize)) == 0) {
@@ -354,29 +451,38 @@ register unsigned	newsize;
 }
 
 /*
- * grow_line(lp, n)
- *	- increase the size of the space allocated for the line by n bytes.
+ * grow_line(lp, len, n)
+ *	- make room in the line, which holds len characters, for n more.
  *
+ * The caller knows how long the line is, so we don't have to look.
  * This routine returns TRUE immediately if the requested space is available.
  * If not, it attempts to allocate the space and adjust the data structures
  * accordingly, and returns TRUE if this worked.
  * If everything fails it returns FALSE.
  */
 bool_t
-grow_line(lp, n)
+grow_line(lp, len, n)
 Line	*lp;
+int	len;
 int	n;
 {
     int		nsize;
-    char	*ctp;
 
-    ctp = lp->l_text;
-    nsize = (ctp ? strlen(ctp) : 0) + 1 + n;	/* size required */
+    nsize = len + 1 + n;			/* size required */
 
     if (nsize <= lp->l_size) {
 	return(TRUE);
     }
 
+    /*
+     * A line which has to grow is probably being typed into, so
+     * give it some room to spare; otherwise we would be copying
+     * it every MEMCHUNK characters.
+     */
+    if (nsize < lp->l_size + lp->l_size / 2) {
+	nsize = lp->l_size + lp->l_size / 2;
+    }
+
     return lnresize(lp, nsize);
 }
 
@@ -393,9 +499,20 @@ register Line	*lineptr;
     while (lineptr != NULL) {
 	register Line	*nextline;
 
-	if (lineptr->l_text != NULL) {
+	/*
+	 * If another line still has the text, leave it to that one.
+	 */
+	if (lineptr->l_tnext != NULL) {
+	    untwin(lineptr);
+	} else if (lineptr->l_text != NULL) {
 	    free(lineptr->l_text);
 	}
+	if (lineptr->l_cells != NULL) {
+	    free(lineptr->l_cells);
+	}
+	if (lineptr->l_cols != NULL) {
+	    free(lineptr->l_cols);
+	}
 	nextline = lineptr->l_next;
 	RECYCLE(lineptr);
 	lineptr = nextline;
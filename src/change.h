@@ -25,8 +25,10 @@
  * A change may either be a number of lines replaced with a
  * new set, a number of characters removed or a number of
  * characters replaced with a new set. Character changes
- * never straddle line boundaries. A list of these
- * structures forms a complex change. There is also a fourth
+ * never straddle line boundaries. A block of lines may
+ * also be moved elsewhere in the buffer, which is recorded
+ * by line number, without the lines themselves. A list of
+ * these structures forms a complex change. There is also a
  * type of "change", which does not actually change the
  * buffer, but is simply a record of the cursor position at
  * the time of the start of the change. This is needed so
@@ -42,6 +44,7 @@ typedef	struct change {
 	C_LINE,
 	C_CHAR,
 	C_DEL_CHAR,
+	C_MOVE,
 	C_POSITION
     }			c_type;
     unsigned long	c_lineno;
@@ -59,6 +62,10 @@ typedef	struct change {
 	    long    cup_line;
 	    int	    cup_index;
 	}	cu_p;
+	struct {
+	    long	    cum_nlines;
+	    unsigned long   cum_dest;
+	}	cu_m;
     }			c_u;
 } Change;
 
@@ -69,6 +76,8 @@ typedef	struct change {
 #define	c_chars		c_u.cu_c.cuc_chars
 #define	c_pline		c_u.cu_p.cup_line
 #define	c_pindex	c_u.cu_p.cup_index
+#define	c_mlines	c_u.cu_m.cum_nlines
+#define	c_mdest		c_u.cu_m.cum_dest
 
 /*
  * One of these data structures exists for every buffer.
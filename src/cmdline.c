@@ -85,6 +85,7 @@ enum {
     EX_MOVE,
     EX_NEXT,
     EX_NUMBER,
+    EX_OUTSTATS,
     EX_OPEN,
     EX_PRESERVE,
     EX_PRINT,
@@ -100,6 +101,7 @@ enum {
     EX_SUSPEND,
     EX_SUBSTITUTE,
     EX_TAG,
+    EX_TAGSTATS,
     EX_UNABBREV,
     EX_UNDO,
     EX_UNMAP,
@@ -221,6 +223,7 @@ static	struct	ecmd	{
   { "number",	    EX_NUMBER,	    0,	0,			ec_none },
 
   { "open",	    EX_OPEN,	    0,	0,			ec_none },
+  { "outstats",	    EX_OUTSTATS,    0,	EC_EXCLAM,		ec_none },
 
   { "preserve",	    EX_PRESERVE,    0,	0,			ec_none },
   { "print",	    EX_PRINT,	    1,	0,			ec_none },
@@ -243,7 +246,8 @@ static	struct	ecmd	{
   { "suspend",	    EX_SUSPEND,	    1,	EC_EXCLAM,		ec_none },
 
   { "t",	    EX_COPY,	    1,	0,			ec_line },
-  { "tag",	    EX_TAG,	    0,	EC_EXCLAM,		ec_1string },
+  { "tag",	    EX_TAG,	    1,	EC_EXCLAM,		ec_1string },
+  { "tagstats",	    EX_TAGSTATS,    0,	0,			ec_none },
 
   { "unabbreviate", EX_UNABBREV,    0,	0,			ec_strings },
   { "undo",	    EX_UNDO,	    1,	0,			ec_none },
@@ -685,6 +689,10 @@ char	*cmdline;			/* optional command string */
 	}
 	break;
 
+    case EX_OUTSTATS:
+	vs_stats(curwin->w_vs, exclam);
+	break;
+
     case EX_PRESERVE:
 	if (!exPreserveAllBuffers()) {
 	    error++;
@@ -807,6 +815,10 @@ char	*cmdline;			/* optional command string */
 	}
 	break;
 
+    case EX_TAGSTATS:
+	tagStats();
+	break;
+
     case EX_UNDO:
 	undo();
 	break;
@@ -24,49 +24,240 @@
 #include "xvi.h"
 
 /*
- * Update the window's variables which say where the cursor is.
- * These are row, col and virtcol, curswant if w_set_want_col.
- *
- * We also update w_c_line_size, which is used in screen.c to
- * figure out whether the cursor line has changed size or not.
+ * On long lines, the virtual column at every VC_STEP'th byte is
+ * remembered, so that finding the column of a position means
+ * starting from the nearest checkpoint before it rather than from the
+ * start of the line. A change to the text only invalidates the
+ * checkpoints after the change; see colschanged().
  */
-void
-cursupdate()
+#define	VC_STEP		256
+
+typedef struct linecols {
+    int		lv_key;		/* CELLKEY() they were made with */
+    int		lv_count;	/* number of valid entries in lv_cols */
+    int		lv_size;	/* number of entries allocated */
+    int		lv_cols[1];	/* lv_cols[n] is column of n * VC_STEP */
+} LineCols;
+
+static	LineCols *getcols P((Line *, int));
+static	bool_t	addcol P((Line *, LineCols *));
+static	int	virtcol P((Line *, int));
+
+/*
+ * Return the column checkpoints for the given line, with room for
+ * at least "need" of them and the first one filled in, or NULL
+ * if there is not enough memory.
+ */
+static LineCols *
+getcols(lp, need)
+Line	*lp;
+int	need;
+{
+    register LineCols	*lv;
+    int			key;
+
+    key = CELLKEY();
+    lv = lp->l_cols;
+    if (lv == NULL || lv->lv_size < need) {
+	LineCols	*newlv;
+	int		size;
+
+	/*
+	 * Leave room for the line to grow.
+	 */
+	size = need + need / 2 + 8;
+	newlv = (LineCols *) realloc((genptr *) lv,
+				sizeof(LineCols) + size * sizeof(int));
+	if (newlv == NULL) {
+	    return(NULL);
+	}
+	if (lv == NULL) {
+	    newlv->lv_count = 0;
+	}
+	lv = lp->l_cols = newlv;
+	lv->lv_size = size;
+    }
+    if (lv->lv_count == 0 || lv->lv_key != key) {
+	lv->lv_key = key;
+	lv->lv_cols[0] = 0;
+	lv->lv_count = 1;
+    }
+    return(lv);
+}
+
+/*
+ * Add the next checkpoint to the table, if the line is long enough
+ * to have one. There must be room for it.
+ */
+static bool_t
+addcol(lp, lv)
+Line		*lp;
+LineCols	*lv;
 {
-    Xviwin		*win = curwin;
-    register int	i;
     register char	*cltp;
-    register int	ccol;
-    register unsigned	width;
-    register int	index;
-    register int	c;
-    register Posn	*curp;
+    register int	col;
+    register int	n;
 
-    /*
-     * Calculate physical lines from logical lines.
-     */
-    curwin->w_row = cntplines(curwin->w_topline, curwin->w_cursor->p_line);
-    curwin->w_c_line_size = plines(curwin->w_cursor->p_line);
+    cltp = lp->l_text + (lv->lv_count - 1) * VC_STEP;
+    col = lv->lv_cols[lv->lv_count - 1];
+    for (n = VC_STEP; n > 0; n--, cltp++) {
+	if (*cltp == '\0') {
+	    return(FALSE);
+	}
+	col += vischar(*cltp, (char **) NULL, col);
+    }
+    lv->lv_cols[lv->lv_count++] = col;
+    return(TRUE);
+}
+
+/*
+ * Return the virtual column at which the character at the given
+ * index in the given line starts.
+ */
+static int
+virtcol(lp, index)
+Line	*lp;
+int	index;
+{
+    register char	*cltp;
+    register int	i;
+    register int	col;
+    register LineCols	*lv;
+    int			need;
+
+    cltp = lp->l_text;
+    i = col = 0;
 
     /*
-     * Calculate new position within the line.
+     * Start from the nearest checkpoint, adding any we need.
+     * If the line turns out to be shorter than index, start from
+     * the last checkpoint there is; if there is not enough memory,
+     * just count from the start of the line.
      */
+    if (index >= VC_STEP) {
+	need = index / VC_STEP + 1;
+	lv = getcols(lp, need);
+	if (lv != NULL) {
+	    while (lv->lv_count < need && addcol(lp, lv)) {
+		;
+	    }
+	    if (need > lv->lv_count) {
+		need = lv->lv_count;
+	    }
+	    i = (need - 1) * VC_STEP;
+	    col = lv->lv_cols[need - 1];
+	}
+    }
 
-    curp = win->w_cursor;
-    cltp = curp->p_line->l_text;
-    index = curp->p_index;
-    ccol = Pb(P_number) ? NUM_SIZE : 0;
+    for ( ; i < index; i++) {
+	col += vischar(cltp[i], (char **) NULL, col);
+    }
+    return(col);
+}
+
+/*
+ * Return the index of the character in the given line which is shown
+ * at the given virtual column, and set *startp to the column at which
+ * that character starts. If the line is not that long, the index of
+ * its terminating '\0' is returned.
+ */
+int
+colindex(lp, col, startp)
+Line	*lp;
+int	col;
+int	*startp;
+{
+    register char	*cltp;
+    register int	i;
+    register int	vcol;
+    register int	width;
+    register LineCols	*lv;
+    int			lo, hi, mid;
+
+    cltp = lp->l_text;
+    i = vcol = 0;
+
+    lv = getcols(lp, 1);
+    if (lv != NULL) {
+	/*
+	 * Make sure that the checkpoints reach past the column,
+	 * or to the end of the line, then find the last one
+	 * before it.
+	 */
+	while (lv->lv_cols[lv->lv_count - 1] <= col) {
+	    if (lv->lv_count >= lv->lv_size &&
+			(lv = getcols(lp, lv->lv_count + 1)) == NULL) {
+		break;
+	    }
+	    if (!addcol(lp, lv)) {
+		break;
+	    }
+	}
+	if (lv != NULL) {
+	    lo = 0;
+	    hi = lv->lv_count - 1;
+	    while (lo < hi) {
+		mid = hi - (hi - lo) / 2;
+		if (lv->lv_cols[mid] <= col) {
+		    lo = mid;
+		} else {
+		    hi = mid - 1;
+		}
+	    }
+	    i = lo * VC_STEP;
+	    vcol = lv->lv_cols[lo];
+	}
+    }
+
+    for ( ; cltp[i] != '\0'; i++) {
+	width = vischar(cltp[i], (char **) NULL, vcol);
+	if (vcol + width > col) {
+	    break;
+	}
+	vcol += width;
+    }
+    *startp = vcol;
+    return(i);
+}
+
+/*
+ * The text of the given line has changed from the given index onwards,
+ * so forget any column checkpoints which lie beyond it.
+ */
+void
+colschanged(lp, index)
+Line	*lp;
+int	index;
+{
+    register LineCols	*lv = lp->l_cols;
+
+    if (lv != NULL && lv->lv_count > index / VC_STEP + 1) {
+	lv->lv_count = index / VC_STEP + 1;
+    }
+}
+
+/*
+ * Return the virtual column at which the cursor is shown
+ * for the given position.
+ */
+int
+cursorcol(posp)
+Posn	*posp;
+{
+    register char	*cltp;
+    register int	ccol;
+    register unsigned	width;
+    register int	index;
+
+    cltp = posp->p_line->l_text;
+    index = posp->p_index;
 
     /*
-     * Work out the virtual column within the current line.
-     *
-     * This loop needs to be as fast as possible; it gets called very
-     * often.
+     * Tab stops are counted from the start of the text,
+     * as line_to_new() displays it.
      */
-    for (i = width = 0; i <= index;) {
-	ccol += width;
-	width = vischar((c = cltp[i++]), (char **) NULL, ccol);
-    }
+    ccol = virtcol(posp->p_line, index);
+    width = vischar(cltp[index], (char **) NULL, ccol);
 
     /*
      * If we are inserting or replacing, the cursor goes to the first column
@@ -79,18 +270,83 @@ cursupdate()
     if (State != INSERT && State != REPLACE && cltp[index] != '\0') {
 	ccol += width - 1;
     }
+    return(ccol);
+}
+
+/*
+ * Return the screen row, counting from the first row of its line,
+ * on which the cursor is shown for the given position.
+ */
+long
+linerow(posp)
+Posn	*posp;
+{
+    register long	ccol;
+
+    ccol = cursorcol(posp);
+    if (Pb(P_number)) {
+	ccol += NUM_SIZE;
+    }
+    return(ccol / curwin->w_ncols);
+}
+
+/*
+ * Update the window's variables which say where the cursor is.
+ * These are row, col and virtcol, curswant if w_set_want_col.
+ *
+ * We also update w_c_line_size, which is used in screen.c to
+ * figure out whether the cursor line has changed size or not.
+ */
+void
+cursupdate()
+{
+    Xviwin		*win = curwin;
+    register int	ccol;
+
+    /*
+     * Calculate physical lines from logical lines.
+     */
+    win->w_row = cntplines(win->w_topline, win->w_cursor->p_line);
+    win->w_c_line_size = plines(win->w_cursor->p_line);
 
     /*
-     * If showing line numbers, adjust the virtual column within the line.
+     * Work out the virtual column within the current line.
      */
-    win->w_virtcol = ccol - (Pb(P_number) ? NUM_SIZE : 0);
+    ccol = cursorcol(win->w_cursor);
+    win->w_virtcol = ccol;
+
+    /*
+     * With wrap unset, the line may be scrolled sideways.
+     */
+    if (!Pb(P_wrap)) {
+	ccol -= win->w_leftcol;
+	if (ccol < 0) {
+	    ccol = 0;
+	}
+    }
+
+    /*
+     * If showing line numbers, the screen column is further along.
+     */
+    if (Pb(P_number)) {
+	ccol += NUM_SIZE;
+    }
 
     /*
      * Convert virtual column to screen column by line folding.
+     * If the top line is too big for the window, the window starts
+     * part of the way through it.
      */
-    while (ccol >= win->w_ncols) {
-	win->w_row++;
-	ccol -= win->w_ncols;
+    if (ccol >= win->w_ncols) {
+	if (Pb(P_wrap)) {
+	    win->w_row += ccol / win->w_ncols;
+	    ccol %= win->w_ncols;
+	} else {
+	    ccol = win->w_ncols - 1;
+	}
+    }
+    if (win->w_cursor->p_line == win->w_topline) {
+	win->w_row -= win->w_skiprows;
     }
     win->w_col = ccol;
 
@@ -62,6 +62,9 @@ VirtScr	defscr = {
     ins_str,		/* v_insert	    */
     scroll,		/* v_scroll	    */
     can_scroll,		/* v_can_scroll     */
+    NOFUNC,		/* v_delete	    */
+    NOFUNC,		/* v_insdel_cost    */
+    NOFUNC,		/* v_stats	    */
 };
 
 void
@@ -36,6 +36,9 @@ bool_t	literal_next = FALSE;
  */
 
 static	void	end_replace P((int));
+static	bool_t	plain_text P((char *));
+static	bool_t	repeat_insert P((void));
+static	void	insert_text P((char *));
 
 /*
  *	Local variables
@@ -194,7 +197,7 @@ bool_t	insert;
 	     * clear the insert buffer - this is not quite right
 	     * but will do for now.
 	     */
-	    if (Ins_repeat > 0) {
+	    if (Ins_repeat > 0 && !repeat_insert()) {
 		stuff("%s%c", flexgetstr(&Insbuff), ESC);
 		flexclear(&Insbuff);
 		Ins_repeat--;
@@ -710,6 +713,197 @@ bool_t	insert;
     return(TRUE);
 }
 
+/*
+ * Insert a block of pasted text at the cursor in insert mode.
+ *
+ * Unlike typed text, this is put into the buffer as it stands, with
+ * a single replchars() for the current line and a single repllines()
+ * for any new ones. Maps, special characters, autoindent, wrapmargin
+ * and showmatch are not applied, and the screen is updated only once
+ * at the end. CR and CR-LF line endings are taken as newlines.
+ */
+void
+i_paste(text)
+char	*text;
+{
+    register char	*p;
+
+    /*
+     * Save the text for repeating the insertion later. It will be
+     * replayed through i_proc(), so control characters other than
+     * tab and newline have to be quoted.
+     */
+    for (p = text; *p != '\0'; p++) {
+	int	c = *p & 0xff;
+
+	if (c == '\r') {
+	    if (p[1] == '\n') {
+		continue;
+	    }
+	    c = '\n';
+	} else if ((c < ' ' && c != '\t' && c != '\n') || c == DEL) {
+	    (void) flexaddch(&Insbuff, CTRL('V'));
+	}
+	(void) flexaddch(&Insbuff, c);
+    }
+
+    insert_text(text);
+}
+
+/*
+ * Put the given text into the buffer at the cursor, for i_paste() and
+ * repeat_insert(), leaving the cursor after it.
+ */
+static void
+insert_text(text)
+char	*text;
+{
+    register Posn	*curpos;
+    register char	*p;
+    Line		*lp;		/* line the cursor is on */
+    Line		head;		/* start of list of new lines */
+    Line		*last;		/* last line of the list */
+    char		*first;		/* text up to the first newline */
+    char		*tail;		/* old text after the cursor */
+    int			len;
+    int			taillen;
+
+    curpos = curwin->w_cursor;
+    lp = curpos->p_line;
+
+    len = strcspn(text, "\r\n");
+    if (text[len] == '\0') {
+	/*
+	 * Just one line; insert it into the current one.
+	 */
+	replchars(lp, curpos->p_index, 0, text);
+	curpos->p_index += len;
+    } else {
+	/*
+	 * Split the current line at the cursor: the first line of the
+	 * paste replaces whatever follows the cursor, and that text is
+	 * put back at the end of the last line of the paste.
+	 */
+	tail = strsave(lp->l_text + curpos->p_index);
+	first = alloc((unsigned) len + 1);
+	if (tail == NULL || first == NULL) {
+	    if (tail != NULL) {
+		free(tail);
+	    }
+	    if (first != NULL) {
+		free(first);
+	    }
+	    return;
+	}
+	(void) strncpy(first, text, len);
+	first[len] = '\0';
+	taillen = strlen(tail);
+
+	/*
+	 * Build a list of the new lines.
+	 */
+	head.l_next = NULL;
+	last = &head;
+	p = text + len;
+	do {
+	    Line	*new;
+
+	    p += (p[0] == '\r' && p[1] == '\n') ? 2 : 1;
+	    len = strcspn(p, "\r\n");
+	    new = newline(len + ((p[len] == '\0') ? taillen : 0) + 1);
+	    if (new == NULL) {
+		throw(head.l_next);
+		free(tail);
+		free(first);
+		return;
+	    }
+	    (void) strncpy(new->l_text, p, len);
+	    new->l_text[len] = '\0';
+	    new->l_next = NULL;
+	    new->l_prev = last;
+	    last->l_next = new;
+	    last = new;
+	    p += len;
+	} while (*p != '\0');
+	(void) strcpy(last->l_text + len, tail);
+
+	replchars(lp, curpos->p_index, taillen, first);
+	repllines(lp->l_next, 0L, head.l_next);
+	free(tail);
+	free(first);
+
+	move_cursor(last, len);
+	indentchars = 0;
+    }
+
+    move_window_to_cursor();
+    cursupdate();
+    xvUpdateAllBufferWindows();
+}
+
+/*
+ * Return TRUE if the given insert-buffer text, replayed through
+ * i_proc(), would just put its characters into the buffer as they
+ * stand, so that insert_text() can do the same thing directly.
+ */
+static bool_t
+plain_text(text)
+char	*text;
+{
+    register char	*p;
+
+    if (Pn(P_wrapmargin) != 0) {
+	return(FALSE);
+    }
+    for (p = text; *p != '\0'; p++) {
+	int	c = *p & 0xff;
+
+	if (c == '\n') {
+	    if (Pb(P_autoindent)) {
+		return(FALSE);
+	    }
+	} else if ((c < ' ' && c != '\t') || c == DEL) {
+	    return(FALSE);
+	} else if (Pb(P_showmatch) && (c == ')' || c == '}' || c == ']')) {
+	    return(FALSE);
+	}
+    }
+    return(TRUE);
+}
+
+/*
+ * Do all the remaining repeats of a counted insertion at once, if the
+ * inserted text is plain enough for that, rather than stuffing it back
+ * into the input for each one. This takes time in proportion to the
+ * size of the result, instead of to its size times the number of lines
+ * it is on. Returns FALSE if the text must be replayed after all.
+ */
+static bool_t
+repeat_insert()
+{
+    Flexbuf	text;
+    char	*copy;
+    bool_t	ok;
+
+    copy = flexgetstr(&Insbuff);
+    if (!plain_text(copy)) {
+	return(FALSE);
+    }
+
+    flexnew(&text);
+    for (ok = TRUE; ok && Ins_repeat > 0; Ins_repeat--) {
+	ok = lformat(&text, "%s", copy);
+    }
+    if (ok) {
+	insert_text(flexgetstr(&text));
+    } else {
+	show_error(out_of_memory);
+    }
+    flexdelete(&text);
+    Ins_repeat = 0;
+    return(TRUE);
+}
+
 /*
  * This function is the interface provided for functions in
  * normal mode to go into insert mode. We only come out of
@@ -25,9 +25,39 @@
 static	bool_t	n_proc P((int));
 static	bool_t	c_proc P((int));
 static	bool_t	d_proc P((int));
+static	bool_t	can_defer P((void));
+static	void	start_defer P((void));
+static	void	end_defer P((void));
+static	void	psv_settimer P((void));
+static	bool_t	psv_timed P((void));
 
 volatile int	keystrokes;
 
+#ifdef	HAVE_WATCHFD
+/*
+ * Where the system interface has timers, the automatic preserve
+ * is done by one, which is set again after each event, rather than
+ * by asking for an Ev_timeout.
+ */
+static	long	psv_timer = 0;
+static	int	psv_keys;		/* keystrokes when it was set */
+static	void	psv_expired P((genptr *));
+#endif
+
+/*
+ * While more input is already waiting, screen updates are deferred,
+ * so that pasted text or a long stream of typed-ahead commands is
+ * shown once it has all been processed rather than after every
+ * character. We never defer for more than DEFER_SECS, so that long
+ * runs of input still show progress, except while a counted "@" is
+ * being replayed, which is shown only when it has finished.
+ */
+#define	DEFER_SECS	1
+
+static	bool_t		deferring = FALSE;
+static	unsigned	defer_echo;	/* echo bits turned off while deferring */
+static	long		defer_start;	/* when we started deferring */
+
 /*
  * Should commands be chatty on the status line?
  * True if reading commands from tty.
@@ -58,10 +88,21 @@ xvEvent	*ev;
 	map_char(ev->ev_inchar);
 	break;
 
+    case Ev_chars:
+	{
+	    int	i;
+
+	    keystrokes += ev->ev_nchars;
+	    for (i = 0; i < ev->ev_nchars; i++) {
+		map_char(ev->ev_chars[i] & 0xff);
+	    }
+	}
+	break;
+
     case Ev_timeout:
 	if (map_waiting()) {
 	    map_timeout();
-	} else if (keystrokes >= PSVKEYS) {
+	} else if (keystrokes >= PSVKEYS && !psv_timed()) {
 	    (void) exPreserveAllBuffers();
 	    keystrokes = 0;
 	}
@@ -102,6 +143,30 @@ xvEvent	*ev;
 	mousemove(ev->ev_m_row);
 	break;
 
+    case Ev_paste:
+	/*
+	 * In insert mode, with nothing else waiting to be processed,
+	 * pasted text goes straight into the buffer. Otherwise it is
+	 * treated as if it had been typed.
+	 */
+	if (State == INSERT && !literal_next &&
+			    !map_waiting() && !map_pending()) {
+	    keystrokes += strlen(ev->ev_paste);
+	    i_paste(ev->ev_paste);
+	    if (Pb(P_showmode)) {
+		update_sline();
+	    }
+	    wind_goto();
+	} else {
+	    char	*cp;
+
+	    for (cp = ev->ev_paste; *cp != '\0'; cp++) {
+		keystrokes++;
+		map_char(*cp & 0xff);
+	    }
+	}
+	break;
+
     case Ev_breakin:
 	/*
 	 * We don't have to handle this; any code
@@ -151,6 +216,15 @@ xvEvent	*ev;
     while ((c = map_getc()) != EOF) {
 	bool_t	(*func)P((int));
 
+	if (deferring) {
+	    /*
+	     * Something may have turned them back on.
+	     */
+	    echo &= ~(e_CHARUPDATE | e_SCROLL);
+	} else if (can_defer()) {
+	    start_defer();
+	}
+
 	switch (State) {
 	case NORMAL:
 	case SUBNORMAL:
@@ -208,6 +282,16 @@ xvEvent	*ev;
 	case EXITING:
 	    break;
 	}
+
+	/*
+	 * Show what has been done so far if we have been
+	 * deferring updates for too long, or can't go on.
+	 */
+	if (deferring && (!can_defer() || (!map_replaying() &&
+			    (long) time((time_t *) 0) - defer_start >= DEFER_SECS))) {
+	    end_defer();
+	    VSflush(ev->ev_vs);
+	}
     }
 
     if (State == EXITING) {
@@ -215,17 +299,38 @@ xvEvent	*ev;
 	return(&resp);
     }
 
+    if (deferring && (imessage || !can_defer())) {
+	end_defer();
+    }
+
+    psv_settimer();
+
     if (imessage) {
 	show_message("Interrupted");
 	wind_goto();	/* put cursor back */
 	imessage = FALSE;
     }
 
+    if (deferring) {
+	/*
+	 * The next character is already waiting.
+	 */
+	resp.xvr_timeout = 0;
+	resp.xvr_type = Xvr_timed_input;
+	return(&resp);
+    }
+
     VSflush(ev->ev_vs);
 
+    /*
+     * If the tags parameters were changed, start reloading
+     * the tags files now, while the user isn't typing.
+     */
+    tagCheckLoad();
+
     if (map_waiting()) {
-	resp.xvr_timeout = (long) Pn(P_timeout);
-    } else if (keystrokes >= PSVKEYS) {
+	resp.xvr_timeout = map_waittime();
+    } else if (keystrokes >= PSVKEYS && !psv_timed()) {
 	resp.xvr_timeout = (long) Pn(P_preservetime) * 1000;
     } else {
 	resp.xvr_timeout = 0;
@@ -234,6 +339,110 @@ xvEvent	*ev;
     return(&resp);
 }
 
+/*
+ * Return TRUE if screen updates may be deferred, because more input
+ * is already waiting and we are in a state where nothing is lost by
+ * not showing the screen until it has been processed.
+ */
+static bool_t
+can_defer()
+{
+    switch (State) {
+    case NORMAL:
+    case SUBNORMAL:
+    case INSERT:
+    case REPLACE:
+	return(map_pending() || kbpending());
+
+    default:
+	return(FALSE);
+    }
+}
+
+/*
+ * Start deferring screen updates. Turning off these echo bits makes
+ * the screen update routines change only the internal screen image.
+ */
+static void
+start_defer()
+{
+    deferring = TRUE;
+    defer_echo = echo & (e_CHARUPDATE | e_SCROLL);
+    echo &= ~(e_CHARUPDATE | e_SCROLL);
+    defer_start = (long) time((time_t *) 0);
+}
+
+/*
+ * Stop deferring, and bring the screen up to date.
+ */
+static void
+end_defer()
+{
+    deferring = FALSE;
+    echo |= defer_echo;
+    redraw_deferred();
+    if (State == CMDLINE) {
+	update_cline();
+    } else {
+	wind_goto();
+    }
+}
+
+/*
+ * After each event, set the preserve timer to go off once nothing has
+ * been typed for Pn(P_preservetime) seconds, if there have been enough
+ * keystrokes since the buffers were last preserved. Events which
+ * bring no input, such as the regular Ev_timeout, leave it alone.
+ */
+static void
+psv_settimer()
+{
+#ifdef	HAVE_WATCHFD
+    if (psv_timer != 0 && keystrokes == psv_keys) {
+	return;
+    }
+    if (psv_timer != 0) {
+	sys_deltimer(psv_timer);
+	psv_timer = 0;
+    }
+    if (keystrokes >= PSVKEYS) {
+	psv_timer = sys_addtimer((long) Pn(P_preservetime) * 1000,
+					psv_expired, (genptr *) NULL);
+	psv_keys = keystrokes;
+    }
+#endif
+}
+
+/*
+ * Return TRUE if the preserve timer is set; if not, we have to
+ * ask for an Ev_timeout to know when to preserve the buffers.
+ */
+static bool_t
+psv_timed()
+{
+#ifdef	HAVE_WATCHFD
+    return(psv_timer != 0);
+#else
+    return(FALSE);
+#endif
+}
+
+#ifdef	HAVE_WATCHFD
+/*
+ * Called while we are waiting for input, when the preserve timer
+ * goes off.
+ */
+/*ARGSUSED*/
+static void
+psv_expired(arg)
+genptr	*arg;
+{
+    psv_timer = 0;
+    (void) exPreserveAllBuffers();
+    keystrokes = 0;
+}
+#endif
+
 /*
  * Process the given character in normal (command) mode.
  *
@@ -314,7 +314,7 @@ Line	*l1, *l2;		/* start and end (inclusive) of range */
 Line	*destline;		/* destination line for copy/move */
 {
     Posn	p1, p2;
-    Posn	destpos;
+    Line	*newlines;	/* lines at the destination */
 
     p1.p_line = (l1 != NULL) ? l1 : curwin->w_cursor->p_line;
     p2.p_line = (l2 != NULL) ? l2 : p1.p_line;
@@ -343,42 +343,58 @@ Line	*destline;		/* destination line for copy/move */
     }
 
     /*
-     * Yank the text.
-     * For delete and yank, the removed text goes into the default buffer.
-     * For move and copy, we use the secret buffer '=' as a temporary.
+     * For delete and yank, the text goes into the default buffer.
+     * For copy, the lines are copied straight to the destination,
+     * and for move they are just unlinked and linked in again there,
+     * which also keeps any marks on them.
      */
-    if (!do_yank(&p1, &p2, FALSE,
-		 (type == 'd' || type == 'y') ? '@' : '=')) {
-	return(FALSE);
+    newlines = NULL;
+    if (type == 'd' || type == 'y') {
+	if (!do_yank(&p1, &p2, FALSE, '@')) {
+	    return(FALSE);
+	}
+    } else if (type == 't') {
+	newlines = copy_lines(p1.p_line, p2.p_line->l_next);
+	if (newlines == NULL) {
+	    return(FALSE);
+	}
     }
 
     if (!start_command(NULL)) {
+	throw(newlines);
 	return(FALSE);
     }
 
     switch (type) {
     case 'd':			/* delete */
-    case 'm':			/* move */
 	move_cursor(p1.p_line, 0);
 	repllines(p1.p_line, cntllines(p1.p_line, p2.p_line),
 						(Line *) NULL);
 	xvUpdateAllBufferWindows();
 	cursupdate();
 	begin_line(TRUE);
-    }
+	break;
 
-    switch (type) {
     case 't':			/* copy */
+	repllines(destline->l_next, 0L, newlines);
+	break;
+
     case 'm':			/* move */
+	movelines(p1.p_line, p2.p_line, destline);
+	newlines = p1.p_line;
+	break;
+    }
+
+    if (newlines != NULL) {
 	/*
-	 * And put it back at the destination point.
+	 * Put the cursor on the first of the lines
+	 * at the destination.
 	 */
-	destpos.p_line = destline;
-	destpos.p_index = 0;
-	do_put(&destpos, FORWARD, '=', NULL);
-
-	xvUpdateAllBufferWindows();
+	move_cursor(newlines, 0);
+	begin_line(TRUE);
+	move_window_to_cursor();
 	cursupdate();
+	xvUpdateAllBufferWindows();
     }
 
     end_command();
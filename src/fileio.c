@@ -438,7 +438,12 @@ char		*no_file_str;
 		continue;
 
 	    if (col >= lp->l_size - 1) {
-		if (!lnresize(lp, col + 2)) {
+		/*
+		 * Grow long lines by half as much again, or reading
+		 * one would take time proportional to its square.
+		 * The line is trimmed to size when we reach its end.
+		 */
+		if (!lnresize(lp, col + col / 2 + 2)) {
 		    goto nomem;
 		}
 		buff = lp->l_text;
@@ -18,14 +18,14 @@
 SYSDEFS=	-DUNIX -DTERMIOS -DPOSIX
 INCDIRS=
 
-LIBS=		-ltermcap
+LIBS=		-ltermcap -lpthread
 LDFLAGS=
 
 CFLAGS=		$(SYSDEFS) $(INCDIRS) -g
 LINTFLAGS=	$(SYSDEFS) $(INCDIRS) -ah
 
-MACHSRC=	unix.c tcapmain.c tcap_scr.c
-MACHOBJ=	unix.o tcapmain.o tcap_scr.o
+MACHSRC=	unix.c tcapmain.c tcap_scr.c memscr.c
+MACHOBJ=	unix.o tcapmain.o tcap_scr.o memscr.o
 MACHINC=	unix.h termcap.h
 
 GENINC=		ascii.h change.h cmd.h param.h ptrfunc.h regexp.h regmagic.h \
@@ -32,24 +32,31 @@
 #include "xvi.h"
 
 /*
- * This is the fundamental structure type which is used
- * to hold mappings from one string to another.
+ * Each set of mappings from one string to another is held as a trie:
+ * every node stands for a string which is a prefix of at least one
+ * lhs, and its children, kept sorted by character so that they can
+ * be binary-searched, extend that string by one character each.
+ * A node whose string is a complete lhs holds the map's lhs and rhs.
+ * So matching costs the same for each input character however many
+ * maps there are.
  */
 typedef struct map {
-    struct map	    *m_next;
-    char	    *m_lhs;		/* lhs of map */
+    struct map	    *m_parent;		/* NULL for the root */
+    struct map	    **m_kids;		/* children, sorted by m_char */
+    int		    m_nkids;		/* how many children */
+    unsigned char   m_char;		/* last character of our string */
+    char	    *m_lhs;		/* lhs of map, or NULL if none */
     char	    *m_rhs;		/* rhs of map */
-    unsigned int    m_same;		/* no characters same as next map */
 } Map;
 
 /*
- * This structure holds a current position while scanning a map list.
- * It is also effectively used to form a chain of mapping structures,
- * interconnected with flexbufs.
+ * This structure holds a current position while matching against
+ * a map trie. It is also effectively used to form a chain of mapping
+ * structures, interconnected with flexbufs.
  */
 typedef struct mpos {
-    Map		*mp_map;
-    int		mp_index;
+    Map		*mp_map;		/* node reached so far */
+    int		mp_index;		/* number of characters matched */
     Flexbuf	*mp_src;
     Flexbuf	*mp_dest;
 } Mpos;
@@ -72,33 +79,75 @@ static	Mpos	npos = { NULL, 0, &canon_queue,	&mapped_queue };
 static	Mpos	kpos = { NULL, 0, &raw_queue,	&canon_queue };
 
 /*
- * These map structures are used for NORMAL mode and for INSERT/REPLACE modes,
+ * These map tries are used for NORMAL mode and for INSERT/REPLACE modes,
  * respectively. They translate between the canonical and mapped queues.
  */
-static	Map	*cmd_map = NULL;
-static	Map	*ins_map = NULL;
+static	Map	cmd_map;
+static	Map	ins_map;
 
 /*
- * This map structure holds translations from the raw to the canonical form.
+ * This map trie holds translations from the raw to the canonical form.
  * Note that this is set up by calls to xvi_keymap() from the terminal-specific
  * module, as this module has knowledge of the escape sequence which must be
  * mapped into the right canonical forms.
  */
-static	Map	*key_map = NULL;
+static	Map	key_map;
 
 /*
- * This is used for "display" mode; it records the current map which
- * is being displayed. It is used by show_map().
+ * A counted "@" command is replayed from a single copy of the text,
+ * which is put into the canonical queue each time that runs dry, until
+ * it has been used replay_count times. This saves building a queue
+ * holding every copy of it. Only an interrupt or a failing command
+ * (which calls unstuff()) stops it early.
  */
-static	Map	*curmap;
+static	char	*replay_text = NULL;
+static	long	replay_count = 0;
+
+#ifdef	HAVE_MSCLOCK
+/*
+ * Adaptive key timeout. The characters of an escape sequence sent by a
+ * function key normally arrive together, so waiting the full "timeout"
+ * after an ESC to see whether one is coming mostly just delays the ESC.
+ * If "adapttimeout" is set, we note the longest gap we have seen between
+ * the characters of sequences which did turn out to be keys; once we
+ * have seen ADAPT_SEQS of them, we wait only ADAPT_FACTOR times that
+ * long (but at least ADAPT_MIN milliseconds, and no more than "timeout")
+ * for the rest of a key sequence.
+ *
+ * If a wait we cut short turns out to have been too short, because the
+ * next character to arrive would have continued the sequence, the gap
+ * counts too, so it doesn't happen again.
+ */
+#define	ADAPT_SEQS	3
+#define	ADAPT_FACTOR	3
+#define	ADAPT_MIN	20
+
+static	long	lastchar;		/* when the last character arrived */
+static	long	seqgap;			/* longest gap in this key sequence */
+static	long	maxgap;			/* longest gap in any key sequence */
+static	int	nseqs;			/* key sequences seen */
+static	Map	*lastkeywait;		/* key sequence which just timed out */
+#endif
+
+/*
+ * These are used for "display" mode; they record the maps which
+ * are being displayed, in order, and the next one to show. They
+ * are used by show_map().
+ */
+static	Map	**showlist;
+static	int	nshow;
+static	int	curshow;
 static	char	*show_map P((void));
+static	int	list_maps P((Map *, Map **));
 
 static	void	mapthrough P((Mpos *, Map *));
 static	bool_t	process_map P((int, Mpos *));
-static	void	calc_same P((Map *));
-static	void	map_failed P((Mpos *));
-static	void	insert_map P((Map **, char *, char *));
-static	void	delete_map P((Map **, char *));
+static	Map	*find_kid P((Map *, int));
+static	int	map_failed P((Mpos *));
+static	void	unmatch P((Map *, Mpos *, int *));
+static	void	insert_map P((Map *, char *, char *));
+static	void	delete_map P((Map *, char *));
+static	void	prune_map P((Map *));
 
 /*VARARGS1*/
 /*PRINTFLIKE*/
@@ -145,6 +194,53 @@ unstuff()
 	flexclear(npos.mp_dest);
 	/* Clear mapped input */
 	flexclear(npos.mp_src);
+	/* Stop any replay */
+	map_endreplay();
+}
+
+/*
+ * Arrange for the given text to be fed into the canonical queue, count
+ * times over, as if it had been typed. This is only possible when no
+ * other stuffed input is waiting and no other replay is running, since
+ * the copies must follow each other, and nothing else; returns FALSE if
+ * it is not, or there is no memory for the copy.
+ */
+bool_t
+map_replay(text, count)
+char	*text;
+long	count;
+{
+    if (replay_text != NULL || !flexempty(npos.mp_src) || count <= 0) {
+	return(FALSE);
+    }
+    replay_text = strsave(text);
+    if (replay_text == NULL) {
+	return(FALSE);
+    }
+    replay_count = count;
+    return(TRUE);
+}
+
+/*
+ * Return TRUE if a replay started by map_replay() is still running.
+ */
+bool_t
+map_replaying()
+{
+    return(replay_text != NULL);
+}
+
+/*
+ * Abandon any replay started by map_replay().
+ */
+void
+map_endreplay()
+{
+    if (replay_text != NULL) {
+	free(replay_text);
+	replay_text = NULL;
+    }
+    replay_count = 0;
 }
 
 /*
@@ -154,6 +250,24 @@ void
 map_char(c)
 register int	c;
 {
+#ifdef	HAVE_MSCLOCK
+    long	now;
+
+    now = sys_msclock();
+    if (kpos.mp_map != NULL && flexempty(kpos.mp_src)) {
+	if (now - lastchar > seqgap) {
+	    seqgap = now - lastchar;
+	}
+    } else if (lastkeywait != NULL) {
+	if (now - lastchar < Pn(P_timeout) &&
+				find_kid(lastkeywait, c) != NULL &&
+				now - lastchar > maxgap) {
+	    maxgap = now - lastchar;
+	}
+	lastkeywait = NULL;
+    }
+    lastchar = now;
+#endif
     (void) flexaddch(kpos.mp_src, c);
 }
 
@@ -178,6 +292,7 @@ map_getc()
 	    if (!literal_next) {
 		/* An interrupt drops any pending input */
 		flexclear(&canon_queue);
+		map_endreplay();
 		imessage = TRUE;
 	    } else {
 		/* After a ^V, ^C just inserts a ^C */
@@ -191,14 +306,20 @@ map_getc()
 		return(flexpopch(npos.mp_src));
 	    }
 	    mapthrough(&npos,
-			(State == NORMAL) ? cmd_map :
+			(State == NORMAL) ? &cmd_map :
 			(State == INSERT ||
 			 State == REPLACE ||
-			 State == CMDLINE) ? ins_map :
+			 State == CMDLINE) ? &ins_map :
 			NULL);
+	} else if (replay_text != NULL) {
+	    /* Start the next copy of a replayed buffer */
+	    if (!flexinsstr(npos.mp_src, 0, replay_text) ||
+					--replay_count <= 0) {
+		map_endreplay();
+	    }
 	} else if (!flexempty(kpos.mp_src)) {
 	    /* Transfer chars from raw to canon queue */
-	    mapthrough(&kpos, key_map);
+	    mapthrough(&kpos, &key_map);
 	} else {
 	    break;
 	}
@@ -208,7 +329,7 @@ map_getc()
 
 /*
  * Process any characters in the canonical queue through the cmd_map/ins_map
- * lists into the mapped queue, whence characters go into the editor itself.
+ * tries into the mapped queue, whence characters go into the editor itself.
  */
 static void
 mapthrough(mp, map)
@@ -216,6 +337,10 @@ Mpos	*mp;
 Map	*map;
 {
     if (mp->mp_map == NULL) {
+	if (map == NULL) {
+	    (void) flexaddch(mp->mp_dest, flexpopch(mp->mp_src));
+	    return;
+	}
 	mp->mp_map = map;
 	mp->mp_index = 0;
     }
@@ -228,8 +353,8 @@ Map	*map;
 }
 
 /*
- * Process the given character through the maplist pointed to
- * by the given position. Returns TRUE if we should continue,
+ * Process the given character through the map trie from the node
+ * given by the position. Returns TRUE if we should continue,
  * or FALSE if this attempt at mapping has terminated (either
  * due to success or definite failure).
  */
@@ -240,115 +365,209 @@ register Mpos	*pos;
 {
     register Map	*tmp;
     register int	ind;
+    int			nback;
+
+    tmp = find_kid(pos->mp_map, c);
+    if (tmp != NULL) {
+	if (tmp->m_lhs != NULL) {
+	    /*
+	     * Found complete match. Insert the result into the
+	     * appropriate buffer, according to whether "remap"
+	     * is set or not. Note that a map whose lhs is the
+	     * start of a longer one's wins straight away.
+	     *
+	     * If we're remapping, we need to insert the rhs into the
+	     * beginning of the input queue. Flexbufs don't support
+	     * such inserts, so we have to shuffle the data around.
+	     */
+	    if (Pb(P_remap) && pos->mp_src != NULL) {
+		int offset = 0;	/* Chars to skip when adding rhs */
 
-    ind = pos->mp_index;
-    for (tmp = pos->mp_map; tmp != NULL; tmp = tmp->m_next) {
-	if (tmp->m_lhs[ind] == c) {
-	    if (tmp->m_lhs[ind + 1] == '\0') {
 		/*
-		 * Found complete match. Insert the result into the
-		 * appropriate buffer, according to whether "remap"
-		 * is set or not.
-		 *
-		 * If we're remapping, we need to insert the rhs into the
-		 * beginning of the input queue. Flexbufs don't support
-		 * such inserts, so we have to shuffle the data around.
+		 * If the RHS starts with the LHS, don't remap those
+		 * characters.
 		 */
-		if (Pb(P_remap) && pos->mp_src != NULL) {
-		    int offset = 0;	/* Chars to skip when adding rhs */
-
-		    /*
-		     * If the RHS starts with the LHS, don't remap those
-		     * characters.
-		     */
-		    {
-			int lhslen = strlen(tmp->m_lhs);
-			if (strncmp(tmp->m_lhs, tmp->m_rhs, lhslen) == 0) {
-			    lformat(pos->mp_dest, "%s", tmp->m_lhs);
-			    offset = lhslen;
-			}
+		{
+		    int lhslen = strlen(tmp->m_lhs);
+		    if (strncmp(tmp->m_lhs, tmp->m_rhs, lhslen) == 0) {
+			lformat(pos->mp_dest, "%s", tmp->m_lhs);
+			offset = lhslen;
 		    }
-		    flexinsstr(pos->mp_src, 0, tmp->m_rhs+offset);
-		} else {
-		    (void) lformat(pos->mp_dest, "%s", tmp->m_rhs);
 		}
-		return(FALSE);
+		flexinsstr(pos->mp_src, 0, tmp->m_rhs+offset);
 	    } else {
-		/*
-		 * Found incomplete match,
-		 * keep going.
-		 */
-		pos->mp_map = tmp;
-		pos->mp_index++;
+		(void) lformat(pos->mp_dest, "%s", tmp->m_rhs);
 	    }
-	    return(TRUE);
-	}
-
-	/*
-	 * Can't move on to next map entry unless the m_same
-	 * field is sufficient that the match so far would
-	 * have worked.
-	 */
-	if (tmp->m_same < ind) {
-	    break;
+#ifdef	HAVE_MSCLOCK
+	    if (pos == &kpos) {
+		if (seqgap > maxgap) {
+		    maxgap = seqgap;
+		}
+		nseqs++;
+		seqgap = 0;
+	    }
+#endif
+	    pos->mp_map = NULL;
+	    return(FALSE);
+	} else {
+	    /*
+	     * Found incomplete match,
+	     * keep going.
+	     */
+	    pos->mp_map = tmp;
+	    pos->mp_index++;
 	}
+	return(TRUE);
     }
 
-    map_failed(pos);
+    ind = pos->mp_index;
+    nback = map_failed(pos);
 
     /*
      * Don't forget to re-stuff the character we have just received.
+     * It goes after any that map_failed() put back, but before
+     * whatever input is still waiting.
      */
     if (pos->mp_src != NULL && ind > 0) {
-	(void) flexaddch(pos->mp_src, c);
+	(void) flexinsch(pos->mp_src, nback, c);
     } else {
 	(void) flexaddch(pos->mp_dest, c);
     }
     return(FALSE);
 }
 
+/*
+ * Find the child of the given node for character c, or NULL.
+ */
+static Map *
+find_kid(node, c)
+Map	*node;
+int	c;
+{
+    register int	lo, hi, mid;
+
+    c &= 0xff;
+    lo = 0;
+    hi = node->m_nkids - 1;
+    while (lo <= hi) {
+	mid = (lo + hi) / 2;
+	if (node->m_kids[mid]->m_char == c) {
+	    return(node->m_kids[mid]);
+	} else if (node->m_kids[mid]->m_char < c) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid - 1;
+	}
+    }
+    return(NULL);
+}
+
 void
 map_timeout()
 {
     if (kpos.mp_map != NULL) {
-	map_failed(&kpos);
+#ifdef	HAVE_MSCLOCK
+	lastkeywait = kpos.mp_map;
+#endif
+	(void) map_failed(&kpos);
     } else {
-	map_failed(&npos);
+	(void) map_failed(&npos);
     }
 }
 
+/*
+ * Return the number of milliseconds to wait for more input
+ * while map_waiting().
+ */
+long
+map_waittime()
+{
+#ifdef	HAVE_MSCLOCK
+    if (kpos.mp_map != NULL && Pb(P_adapttimeout) && nseqs >= ADAPT_SEQS) {
+	long	t;
+
+	t = maxgap * ADAPT_FACTOR;
+	if (t < ADAPT_MIN) {
+	    t = ADAPT_MIN;
+	}
+	if (t < Pn(P_timeout)) {
+	    return(t);
+	}
+    }
+#endif
+    return((long) Pn(P_timeout));
+}
+
 bool_t
 map_waiting()
 {
     return(kpos.mp_map != NULL || npos.mp_map != NULL);
 }
 
+/*
+ * Return TRUE if map_getc() has more characters to deliver without
+ * waiting for the keyboard: either some are already mapped, a replay
+ * is running, or some raw or canonical ones are queued and no map is
+ * part-way through matching them.
+ */
+bool_t
+map_pending()
+{
+    return(!flexempty(&mapped_queue) || replay_text != NULL ||
+	    (!map_waiting() &&
+		(!flexempty(&canon_queue) || !flexempty(&raw_queue))));
+}
+
 /*
  * This routine is called when a map has failed. We transfer the first
- * input character into the destination flexbuf, and all the others into
- * the src flexbuf. This gives us a chance to retry maps which fail on
- * the first input character at the next input character.
+ * input character into the destination flexbuf, and all the others back
+ * to the front of the src flexbuf. This gives us a chance to retry maps
+ * which fail on the first input character at the next input character.
+ * Return the number of characters put back into the src flexbuf.
  */
-static void
+static int
 map_failed(pos)
 Mpos	*pos;
 {
-    register char	*cp;
-    register Flexbuf	*fbp;
-    register int	i;
+    int		nback = 0;
 
+#ifdef	HAVE_MSCLOCK
+    if (pos == &kpos) {
+	seqgap = 0;
+    }
+#endif
     if (pos->mp_map != NULL) {
+	unmatch(pos->mp_map, pos, &nback);
+	pos->mp_map = NULL;
+    }
+    return(nback);
+}
 
-	cp = pos->mp_map->m_lhs;
-	if (pos->mp_index > 0) {
-	    (void) flexaddch(pos->mp_dest, cp[0]);
-	}
+/*
+ * Put back the characters matched on the way to the given node,
+ * for map_failed(). They're only held in the trie itself, so we
+ * walk back up it and add them on the way back down. Those that
+ * go back into the source queue go at the front of it, in order;
+ * *np counts them.
+ */
+static void
+unmatch(node, pos, np)
+Map	*node;
+Mpos	*pos;
+int	*np;
+{
+    Map	*parent = node->m_parent;
 
-	fbp = (pos->mp_src != NULL) ? pos->mp_src : pos->mp_dest;
-	for (i = 1; i < pos->mp_index; i++) {
-	    (void) flexaddch(fbp, cp[i]);
-	}
-	pos->mp_map = NULL;
+    if (parent == NULL) {
+	return;
+    }
+    unmatch(parent, pos, np);
+    if (parent->m_parent == NULL) {
+	(void) flexaddch(pos->mp_dest, node->m_char);
+    } else if (pos->mp_src != NULL) {
+	(void) flexinsch(pos->mp_src, (*np)++, node->m_char);
+    } else {
+	(void) flexaddch(pos->mp_dest, node->m_char);
     }
 }
 
@@ -486,7 +705,17 @@ xvi_map(arg, exclam)
 	}
     }
     if (arg == NULL || arg[0] == '\0') {
-	curmap = exclam ? ins_map : cmd_map;
+	Map	*root = exclam ? &ins_map : &cmd_map;
+
+	free((char *) showlist);
+	nshow = list_maps(root, (Map **) NULL);
+	showlist = (nshow == 0) ? NULL : alloc(nshow * sizeof(Map *));
+	if (showlist == NULL) {
+	    nshow = 0;
+	} else {
+	    (void) list_maps(root, showlist);
+	}
+	curshow = 0;
 	disp_init(show_map, (int) curwin->w_ncols, FALSE);
     } else {
 	char	       *lhs;
@@ -511,81 +740,76 @@ xvi_map(arg, exclam)
     return(TRUE);
 }
 
+/*
+ * Enter a map into the given trie, replacing any map with
+ * the same lhs. We take over the lhs and rhs strings.
+ */
 static void
-insert_map(maplist, lhs, rhs)
-Map		**maplist;
+insert_map(root, lhs, rhs)
+Map		*root;
 char		*lhs;
 char		*rhs;
 {
-    Map		*mptr;			/* new map element */
-    Map		**p;			/* used for loop to find position */
-    int		rel;
-
-    mptr = alloc(sizeof(Map));
-    if (mptr == NULL) {
-	free(lhs);
-	free(rhs);
-	return;
-    }
-
-    mptr->m_lhs = lhs;
-    mptr->m_rhs = rhs;
-
-    p = maplist;
-    if ((*p) == NULL || strcmp((*p)->m_lhs, lhs) > 0) {
-	/*
-	 * Either there are no maps yet, or the one
-	 * we want to enter should go at the start.
-	 */
-	mptr->m_next = *p;
-	*p = mptr;
-	calc_same(mptr);
-    } else if (strcmp((*p)->m_lhs, lhs) == 0) {
-	/*
-	 * We need to replace the rhs of the first map.
-	 */
-	free(lhs);
-	free(mptr);
-	free((*p)->m_rhs);
-	(*p)->m_rhs = rhs;
-	calc_same(*p);
-    } else {
-	for ( ; (*p) != NULL; p = &((*p)->m_next)) {
+    Map		*node;			/* where we are in the trie */
+    Map		*kid;
+    Map		**kids;
+    char	*cp;
+    int		i;
+
+    node = root;
+    for (cp = lhs; *cp != '\0'; cp++) {
+	kid = find_kid(node, *cp);
+	if (kid == NULL) {
 	    /*
-	     * Set "rel" to +ve if the next element is greater
-	     * than the current one, -ve if it is less, or 0
-	     * if they are the same (if the lhs is the same).
+	     * If we run out of memory, get rid of any nodes
+	     * we have made on the way here.
 	     */
-	    rel = ((*p)->m_next == NULL) ? 1 :
-		strcmp((*p)->m_next->m_lhs, lhs);
-
-	    if (rel >= 0) {
-		if (rel > 0) {
-		    /*
-		     * The right place to insert
-		     * the new map.
-		     */
-		    mptr->m_next = (*p)->m_next;
-		    (*p)->m_next = mptr;
-		    calc_same(*p);
-		    calc_same(mptr);
-		} else /* rel == 0 */ {
-		    /*
-		     * The lhs of the new map is identical
-		     * to that of an existing map.
-		     * Replace the old rhs with the new.
-		     */
-		    free(lhs);
-		    free(mptr);
-		    mptr = (*p)->m_next;
-		    free(mptr->m_rhs);
-		    mptr->m_rhs = rhs;
-		    calc_same(mptr);
-		}
+	    kid = alloc(sizeof(Map));
+	    if (kid == NULL) {
+		prune_map(node);
+		free(lhs);
+		free(rhs);
 		return;
 	    }
+	    kids = (node->m_kids == NULL) ?
+		    alloc((node->m_nkids + 1) * sizeof(Map *)) :
+		    re_alloc((char *) node->m_kids,
+				(node->m_nkids + 1) * sizeof(Map *));
+	    if (kids == NULL) {
+		free((char *) kid);
+		prune_map(node);
+		free(lhs);
+		free(rhs);
+		return;
+	    }
+	    node->m_kids = kids;
+	    kid->m_parent = node;
+	    kid->m_kids = NULL;
+	    kid->m_nkids = 0;
+	    kid->m_char = *cp;
+	    kid->m_lhs = kid->m_rhs = NULL;
+
+	    /*
+	     * Keep the children in order.
+	     */
+	    for (i = node->m_nkids; i > 0 && kids[i - 1]->m_char > kid->m_char;
+									i--) {
+		kids[i] = kids[i - 1];
+	    }
+	    kids[i] = kid;
+	    node->m_nkids++;
 	}
+	node = kid;
     }
+
+    /*
+     * If the lhs is identical to that of an existing map,
+     * replace the old one with the new.
+     */
+    free(node->m_lhs);
+    free(node->m_rhs);
+    node->m_lhs = lhs;
+    node->m_rhs = rhs;
 }
 
 bool_t
@@ -618,59 +842,92 @@ bool_t	exclam;
 }
 
 static void
-delete_map(maplist, lhs)
-Map	**maplist;
+delete_map(root, lhs)
+Map	*root;
 char	*lhs;
 {
-    Map	*p;
+    Map		*node;
 
-    p = *maplist;
-    if (p != NULL && strcmp(p->m_lhs, lhs) == 0) {
-	*maplist = p->m_next;
-    } else {
-	for (; p != NULL; p = p->m_next) {
-	    if (p->m_next != NULL && strcmp(lhs, p->m_next->m_lhs) == 0) {
-		Map	*tmp;
-
-		tmp = p->m_next;
-		p->m_next = p->m_next->m_next;
-		free(tmp->m_lhs);
-		free(tmp->m_rhs);
-		free(tmp);
-		calc_same(p);
-	    }
-	}
+    node = root;
+    for ( ; *lhs != '\0' && node != NULL; lhs++) {
+	node = find_kid(node, *lhs);
     }
+    if (node == NULL || node->m_lhs == NULL) {
+	return;
+    }
+    free(node->m_lhs);
+    free(node->m_rhs);
+    node->m_lhs = node->m_rhs = NULL;
+    prune_map(node);
 }
 
+/*
+ * Remove the given node, and any above it, which no longer
+ * lead to any map.
+ */
 static void
-calc_same(mptr)
-Map	*mptr;
+prune_map(node)
+Map	*node;
 {
-    register char	*a, *b;
+    Map		*parent;
+    int		i;
+
+    while (node->m_parent != NULL && node->m_nkids == 0 &&
+					node->m_lhs == NULL) {
+	parent = node->m_parent;
+	for (i = 0; parent->m_kids[i] != node; i++) {
+	    ;
+	}
+	for (parent->m_nkids--; i < parent->m_nkids; i++) {
+	    parent->m_kids[i] = parent->m_kids[i + 1];
+	}
+	free((char *) node->m_kids);
+	free((char *) node);
+	node = parent;
+    }
+}
 
-    mptr->m_same = 0;
-    if (mptr->m_next != NULL) {
-	for (a = mptr->m_lhs, b = mptr->m_next->m_lhs; *a == *b; a++, b++) {
-	    mptr->m_same++;
+/*
+ * Put the nodes in the given trie which hold maps into the given
+ * vector, in order of lhs, and return how many there are. If the
+ * vector is NULL, just count them.
+ */
+static int
+list_maps(node, vec)
+Map	*node;
+Map	**vec;
+{
+    int		n;
+    int		i;
+
+    n = 0;
+    if (node->m_lhs != NULL) {
+	if (vec != NULL) {
+	    vec[n] = node;
 	}
+	n++;
+    }
+    for (i = 0; i < node->m_nkids; i++) {
+	n += list_maps(node->m_kids[i], (vec == NULL) ? NULL : vec + n);
     }
+    return(n);
 }
 
 static char *
 show_map()
 {
     static Flexbuf	buf;
+    Map			*curmap;
 
     /*
      * Have we reached the end?
      */
-    if (curmap == NULL) {
+    if (curshow >= nshow) {
 	return(NULL);
     }
+    curmap = showlist[curshow++];
 
     flexclear(&buf);
     (void) lformat(&buf, "%-18.18s %-s", curmap->m_lhs, curmap->m_rhs);
-    curmap = curmap->m_next;
     return flexgetstr(&buf);
 }
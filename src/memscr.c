@@ -0,0 +1,555 @@
+/* Copyright (c) 1990,1991,1992,1993 Chris and John Downey */
+
+/***
+
+* program name:
+    xvi
+* function:
+    Portable version of UNIX "vi" editor, with extensions.
+* module name:
+    memscr.c
+* module function:
+    VirtScr interface which draws into a grid of character
+    cells in memory instead of on a terminal, and counts what
+    it is asked to do. This lets keystroke scripts be run and
+    timed with no terminal attached, and the cost of screen
+    updates be measured.
+
+    Selected by giving "-H" as the first argument; input is read
+    from the standard input, and when the editor exits, the final
+    screen image is written to the standard output and the counts
+    to the standard error.
+* history:
+    STEVIE - ST Editor for VI Enthusiasts, Version 3.10
+    Originally by Tim Thompson (twitch!tjt)
+    Extensive modifications by Tony Andrews (onecom!wldrdg!tony)
+    Heavily modified by Chris & John Downey
+    Last modified by Martin Guy
+
+***/
+
+#include "xvi.h"
+#include <time.h>
+
+static	VirtScr		*newscr P((VirtScr *, genptr *));
+static	void		closescr P((VirtScr *));
+static	void		clear_all P((VirtScr *));
+static	void		clear_line P((VirtScr *, int, int));
+static	void		xygoto P((VirtScr *, int, int));
+static	void		put_str P((VirtScr *, int, int, char *));
+static	void		put_char P((VirtScr *, int, int, int));
+static	void		ins_str P((VirtScr *, int, int, char *));
+static	void		pset_colour P((VirtScr *, int));
+static	int		scroll P((VirtScr *, int, int, int));
+static	int		can_scroll P((VirtScr *, int, int, int));
+static	void		del_chars P((VirtScr *, int, int, int));
+static	void		flushout P((VirtScr *));
+static	void		pbeep P((VirtScr *));
+static	void		setcell P((int, int, int));
+static	void		copycell P((int, int));
+static	void		mem_report P((void));
+static	char		*memstats P((VirtScr *, int));
+
+static VirtScr	mem_scr = {
+    NULL,		/* pv_sys_ptr       */
+    0,			/* pv_rows	    */
+    0,			/* pv_cols	    */
+    NULL,		/* pv_window	    */
+    NULL,		/* pv_int_lines     */
+    NULL,		/* pv_ext_lines     */
+    { 0, },		/* pv_colours       */
+
+    newscr,		/* v_open	    */
+    closescr,		/* v_close	    */
+    clear_all,		/* v_clear_all	    */
+    clear_line,		/* v_clear_line	    */
+    xygoto,		/* v_goto	    */
+    put_str,		/* v_write	    */
+    put_char,		/* v_putc	    */
+    pset_colour,	/* v_set_colour	    */
+    xv_decode_colour,	/* v_decode_colour  */
+    flushout,		/* v_flush	    */
+    pbeep,		/* v_beep	    */
+
+    ins_str,		/* v_insert	    */
+    scroll,		/* v_scroll	    */
+    can_scroll,		/* v_can_scroll     */
+    del_chars,		/* v_delete	    */
+    NOFUNC,		/* v_insdel_cost    */
+    memstats,		/* v_stats	    */
+};
+
+/*
+ * The screen image: mem_rows * mem_cols cells, each with a
+ * character and a colour.
+ */
+static	char		*cells;
+static	unsigned char	*colours;
+static	int		mem_rows, mem_cols;
+static	int		cur_colour;
+
+/*
+ * Input characters that arrive together are passed on in this.
+ */
+static	char		inbuf[4096];
+
+/*
+ * Operations we count, in the same order as the v_* functions.
+ */
+#define	OP_CLEAR_ALL	0
+#define	OP_CLEAR_LINE	1
+#define	OP_GOTO		2
+#define	OP_WRITE	3
+#define	OP_PUTC		4
+#define	OP_COLOUR	5
+#define	OP_BEEP		6
+#define	OP_INSERT	7
+#define	OP_SCROLL	8
+#define	OP_DELETE	9
+#define	NOPS		10
+
+static	char	*op_names[NOPS] = {
+    "clear_all", "clear_line", "goto", "write", "putc",
+    "colour", "beep", "insert", "scroll", "delete",
+};
+
+/*
+ * Counts for the whole run, and for the current update.
+ * "cells" is the number of cells whose contents actually
+ * changed; "bytes" is the number of characters we were
+ * given to draw.
+ */
+typedef struct {
+    long	c_ops[NOPS];
+    long	c_nops;
+    long	c_cells;
+    long	c_bytes;
+} Counts;
+
+static	Counts	total, now;
+static	long	nflushes;
+static	long	max_ops, max_cells, max_bytes;
+static	clock_t	start_time;
+
+#define	COUNT(op)	(now.c_ops[op]++, now.c_nops++)
+
+void
+memscr_main(argc, argv)
+int	argc;
+char	*argv[];
+{
+    VirtScr	*vs;
+    xvEvent	event;
+    long	timeout = 0;
+    char	*env;
+
+    vs = &mem_scr;
+
+    /*
+     * There is no terminal, so we don't call sys_init(); this
+     * also leaves shell escapes disabled. The size comes from
+     * the environment if it's there.
+     */
+    mem_rows = ((env = getenv("LINES")) != NULL) ? atoi(env) : 0;
+    mem_cols = ((env = getenv("COLUMNS")) != NULL) ? atoi(env) : 0;
+    if (mem_rows < 2)
+	mem_rows = 24;
+    if (mem_cols < 2)
+	mem_cols = 80;
+    cells = malloc((unsigned) (mem_rows * mem_cols));
+    colours = malloc((unsigned) (mem_rows * mem_cols));
+    if (cells == NULL || colours == NULL) {
+	(void) fputs("xvi: not enough memory for screen\n", stderr);
+	exit(1);
+    }
+    (void) memset(cells, ' ', (unsigned) (mem_rows * mem_cols));
+    (void) memset((char *) colours, 0, (unsigned) (mem_rows * mem_cols));
+    vs->pv_rows = mem_rows;
+    vs->pv_cols = mem_cols;
+
+    start_time = clock();
+
+    catch_signals();
+    if (xvi_startup(vs, argc, argv) == NULL) {
+	exit(1);
+    }
+
+    flushout(vs);
+    event.ev_vs = vs;
+    while (1) {
+	xvResponse	*resp;
+	register int	r;
+
+	r = inch(timeout);
+	if (r == EOF) {
+	    if (kbdintr) {
+		event.ev_type = Ev_breakin;
+	    } else if (SIG_terminate) {
+		event.ev_type = Ev_terminate;
+		SIG_terminate = FALSE;
+	    } else if (SIG_user_disconnected) {
+		/*
+		 * This is what end of input looks like.
+		 */
+		event.ev_type = Ev_disconnected;
+		SIG_user_disconnected = FALSE;
+	    } else {
+		event.ev_type = Ev_timeout;
+	    }
+	} else {
+	    int		n;
+
+	    n = kbread(inbuf + 1, sizeof(inbuf) - 1, EOF);
+	    if (n == 0) {
+		event.ev_type = Ev_char;
+		event.ev_inchar = r;
+	    } else {
+		inbuf[0] = r;
+		event.ev_type = Ev_chars;
+		event.ev_chars = inbuf;
+		event.ev_nchars = n + 1;
+	    }
+	}
+	resp = xvi_handle_event(&event);
+	if (resp->xvr_type == Xvr_exit) {
+	    flushout(vs);
+	    mem_report();
+	    exit(resp->xvr_status);
+	}
+	timeout = resp->xvr_timeout;
+    }
+}
+
+/*
+ * Write the screen image to stdout, and the counts to stderr.
+ */
+static void
+mem_report()
+{
+    int		row, col, end;
+    int		op;
+    double	secs;
+
+    for (row = 0; row < mem_rows; row++) {
+	char	*line = &cells[row * mem_cols];
+
+	for (end = mem_cols; end > 0 && line[end - 1] == ' '; end--)
+	    ;
+	for (col = 0; col < end; col++) {
+	    (void) putchar(line[col]);
+	}
+	(void) putchar('\n');
+    }
+    (void) fflush(stdout);
+
+    secs = (double) (clock() - start_time) / CLOCKS_PER_SEC;
+    (void) fprintf(stderr,
+	"%dx%d: %ld flushes, %ld ops, %ld cells, %ld bytes, %.3f secs\n",
+	mem_rows, mem_cols, nflushes,
+	total.c_nops, total.c_cells, total.c_bytes, secs);
+    for (op = 0; op < NOPS; op++) {
+	(void) fprintf(stderr, "%s %ld%s", op_names[op], total.c_ops[op],
+			(op == NOPS - 1) ? "\n" : ", ");
+    }
+    (void) fprintf(stderr,
+	"largest flush: %ld ops, %ld cells, %ld bytes\n",
+	max_ops, max_cells, max_bytes);
+}
+
+/*
+ * Return line number n of the ":outstats" display, or NULL
+ * if there are no more; a negative n resets the counts.
+ */
+/*ARGSUSED*/
+static char *
+memstats(scr, n)
+VirtScr	*scr;
+int	n;
+{
+    static Flexbuf	line;
+
+    if (n < 0) {
+	(void) memset((char *) &total, 0, sizeof(total));
+	nflushes = max_ops = max_cells = max_bytes = 0;
+	return(NULL);
+    }
+    flexclear(&line);
+    if (n < NOPS) {
+	(void) lformat(&line, "%-12s %8ld calls", op_names[n], total.c_ops[n]);
+    } else if (n == NOPS) {
+	(void) lformat(&line, "%-12s %8ld ops, %ld cells, %ld bytes in %ld updates",
+		"Total:", total.c_nops, total.c_cells, total.c_bytes, nflushes);
+    } else {
+	return(NULL);
+    }
+    return(flexgetstr(&line));
+}
+
+/*
+ * Put a character into a cell, counting it if it changes anything.
+ */
+static void
+setcell(row, col, c)
+int	row;
+int	col;
+int	c;
+{
+    int		i;
+
+    if (row < 0 || row >= mem_rows || col < 0 || col >= mem_cols)
+	return;
+    i = row * mem_cols + col;
+    if (cells[i] != c || colours[i] != (unsigned char) cur_colour) {
+	cells[i] = c;
+	colours[i] = cur_colour;
+	now.c_cells++;
+    }
+}
+
+/*
+ * Copy cell number from to cell number to, as when
+ * the terminal moves text about.
+ */
+static void
+copycell(to, from)
+int	to;
+int	from;
+{
+    if (cells[to] != cells[from] || colours[to] != colours[from]) {
+	cells[to] = cells[from];
+	colours[to] = colours[from];
+	now.c_cells++;
+    }
+}
+
+/*ARGSUSED*/
+static VirtScr *
+newscr(scr, win)
+VirtScr	*scr;
+genptr	*win;
+{
+    return(NULL);
+}
+
+/*ARGSUSED*/
+static void
+closescr(scr)
+VirtScr	*scr;
+{
+}
+
+/*ARGSUSED*/
+static void
+clear_all(scr)
+VirtScr	*scr;
+{
+    int		row, col;
+
+    COUNT(OP_CLEAR_ALL);
+    for (row = 0; row < mem_rows; row++) {
+	for (col = 0; col < mem_cols; col++) {
+	    setcell(row, col, ' ');
+	}
+    }
+}
+
+/*ARGSUSED*/
+static void
+clear_line(scr, row, col)
+VirtScr	*scr;
+int	row;
+int	col;
+{
+    COUNT(OP_CLEAR_LINE);
+    for ( ; col < mem_cols; col++) {
+	setcell(row, col, ' ');
+    }
+}
+
+/*ARGSUSED*/
+static void
+xygoto(scr, row, col)
+VirtScr	*scr;
+int	row;
+int	col;
+{
+    COUNT(OP_GOTO);
+}
+
+/*ARGSUSED*/
+static void
+put_str(scr, row, col, str)
+VirtScr	*scr;
+int	row;
+int	col;
+char	*str;
+{
+    COUNT(OP_WRITE);
+    for ( ; *str != '\0'; str++) {
+	setcell(row, col++, *str);
+	now.c_bytes++;
+    }
+}
+
+/*ARGSUSED*/
+static void
+put_char(scr, row, col, c)
+VirtScr	*scr;
+int	row;
+int	col;
+int	c;
+{
+    COUNT(OP_PUTC);
+    setcell(row, col, c);
+    now.c_bytes++;
+}
+
+/*ARGSUSED*/
+static void
+ins_str(scr, row, col, str)
+VirtScr	*scr;
+int	row;
+int	col;
+char	*str;
+{
+    int		n;
+    int		c;
+
+    COUNT(OP_INSERT);
+    if (row < 0 || row >= mem_rows || col < 0 || col >= mem_cols)
+	return;
+    n = strlen(str);
+    if (n > mem_cols - col)
+	n = mem_cols - col;
+    for (c = mem_cols - 1; c >= col + n; c--) {
+	copycell(row * mem_cols + c, row * mem_cols + c - n);
+    }
+    for (c = 0; c < n; c++) {
+	setcell(row, col + c, str[c]);
+	now.c_bytes++;
+    }
+}
+
+/*ARGSUSED*/
+static void
+del_chars(scr, row, col, n)
+VirtScr	*scr;
+int	row;
+int	col;
+int	n;
+{
+    int		c;
+
+    COUNT(OP_DELETE);
+    if (row < 0 || row >= mem_rows || col < 0 || col >= mem_cols)
+	return;
+    if (n > mem_cols - col)
+	n = mem_cols - col;
+    for (c = col; c < mem_cols - n; c++) {
+	copycell(row * mem_cols + c, row * mem_cols + c + n);
+    }
+    for ( ; c < mem_cols; c++) {
+	setcell(row, c, ' ');
+    }
+}
+
+/*ARGSUSED*/
+static void
+pset_colour(scr, colour)
+VirtScr	*scr;
+int	colour;
+{
+    if (colour != cur_colour) {
+	COUNT(OP_COLOUR);
+	cur_colour = colour;
+    }
+}
+
+/*
+ * Move rows start_row to end_row up by nlines (or down,
+ * if nlines is negative), clearing the rows uncovered.
+ */
+/*ARGSUSED*/
+static int
+scroll(scr, start_row, end_row, nlines)
+VirtScr	*scr;
+int	start_row;
+int	end_row;
+int	nlines;
+{
+    int		row, col;
+    int		from;
+
+    COUNT(OP_SCROLL);
+    if (nlines > 0) {
+	for (row = start_row; row <= end_row; row++) {
+	    from = row + nlines;
+	    for (col = 0; col < mem_cols; col++) {
+		if (from <= end_row) {
+		    copycell(row * mem_cols + col, from * mem_cols + col);
+		} else {
+		    setcell(row, col, ' ');
+		}
+	    }
+	}
+    } else if (nlines < 0) {
+	for (row = end_row; row >= start_row; row--) {
+	    from = row + nlines;
+	    for (col = 0; col < mem_cols; col++) {
+		if (from >= start_row) {
+		    copycell(row * mem_cols + col, from * mem_cols + col);
+		} else {
+		    setcell(row, col, ' ');
+		}
+	    }
+	}
+    }
+    return(1);
+}
+
+/*ARGSUSED*/
+static int
+can_scroll(scr, start_row, end_row, nlines)
+VirtScr	*scr;
+int	start_row;
+int	end_row;
+int	nlines;
+{
+    return(1);
+}
+
+/*
+ * The end of a screen update: add this one's counts to the totals.
+ */
+/*ARGSUSED*/
+static void
+flushout(scr)
+VirtScr	*scr;
+{
+    int		op;
+
+    if (now.c_nops == 0)
+	return;
+    nflushes++;
+    for (op = 0; op < NOPS; op++) {
+	total.c_ops[op] += now.c_ops[op];
+    }
+    total.c_nops += now.c_nops;
+    total.c_cells += now.c_cells;
+    total.c_bytes += now.c_bytes;
+    if (now.c_nops > max_ops)
+	max_ops = now.c_nops;
+    if (now.c_cells > max_cells)
+	max_cells = now.c_cells;
+    if (now.c_bytes > max_bytes)
+	max_bytes = now.c_bytes;
+    (void) memset((char *) &now, 0, sizeof(now));
+}
+
+/*ARGSUSED*/
+static void
+pbeep(scr)
+VirtScr	*scr;
+{
+    COUNT(OP_BEEP);
+}
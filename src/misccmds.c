@@ -209,38 +209,27 @@ plines( lp)
 Line	*lp;
 {
     register long	col;
-    register char	*s;
+    register int	columns;
 
-    s = lp->l_text;
-
-    if (*s == '\0')		/* empty line */
-	return(1);
+    if (lp->l_text[0] == '\0' || !Pb(P_wrap))
+	return(1);		/* empty line, or not folded */
 
     /*
-     * If list mode is on, then the '$' at the end of
-     * the line takes up one extra column.
+     * The width of the line's text, including the '$'
+     * in list mode, is usually known from the last time
+     * it was measured or displayed.
      */
-    col = Pb(P_list) ? 1 : 0;
+    col = line_width(lp);
 
     if (Pb(P_number)) {
 	col += NUM_SIZE;
     }
 
-    for ( ; *s != '\0'; s++) {
-	col += vischar(*s, (char **) NULL, (int) col);
-    }
-
-    {
-	register int	row;
-	register int	columns;
-
-	columns = curwin->w_ncols;
-	for (row = 1; col > columns; ) {
-	    row++;
-	    col -= columns;
-	}
-	return row;
+    columns = curwin->w_ncols;
+    if (col <= columns) {
+	return(1);
     }
+    return((col - 1) / columns + 1);
 }
 
 /*
@@ -273,6 +262,18 @@ register Line	*pend;
     }
 
     toomuch = curwin->w_nrows * 2;
+
+    /*
+     * Without wrap, this is just the number of lines.
+     */
+    if (!Pb(P_wrap)) {
+	for (physlines = 0, lp = pbegin; lp != pend && physlines < toomuch;
+							lp = lp->l_next) {
+	    physlines++;
+	}
+	return(physlines);
+    }
+
     for (physlines = 0, lp = pbegin; lp != pend; lp = lp->l_next) {
 	physlines += plines(lp);
 	if (physlines >= toomuch)
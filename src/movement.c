@@ -388,6 +388,7 @@ move_window_to_cursor()
     int			start_row;
     int			end_row;
     Line		*topline;
+    bool_t		oversized;
     Xviwin		*win = curwin;
 
     currline = win->w_cursor->p_line;
@@ -397,6 +398,36 @@ move_window_to_cursor()
     end_row = win->w_cmdline - 1;
     topline = win->w_topline;
 
+    /*
+     * With wrap unset, scroll sideways if the cursor is off
+     * either edge of the window, putting it in the middle.
+     */
+    if (!Pb(P_wrap)) {
+	int	textcols;
+	int	col;
+	int	leftcol;
+
+	textcols = win->w_ncols - (Pb(P_number) ? NUM_SIZE : 0);
+	col = cursorcol(win->w_cursor);
+	leftcol = win->w_leftcol;
+	if (col < leftcol || col >= leftcol + textcols) {
+	    leftcol = (col < textcols) ? 0 : col - textcols / 2;
+	}
+	if (leftcol != win->w_leftcol) {
+	    win->w_leftcol = leftcol;
+	    redraw_window(FALSE);
+	}
+    }
+
+    /*
+     * Only a line which is too big for the window
+     * can start above the top of it.
+     */
+    oversized = !bufempty() && plines(currline) > win->w_nrows - 1;
+    if (!oversized) {
+	win->w_skiprows = 0;
+    }
+
     /*
      * First stage: move window towards cursor.
      */
@@ -408,6 +439,43 @@ move_window_to_cursor()
 	win->w_cursor->p_line = win->w_buffer->b_file;
 	win->w_cursor->p_index = 0;
 
+    } else if (oversized) {
+	long	textrows;
+	long	row;
+	long	skip;
+
+	/*
+	 * The cursor line is too big to fit in the window, so the
+	 * window shows only the part of it that the cursor is in,
+	 * scrolling through it as the cursor moves. It always
+	 * fills the window, so that the next line is off-screen.
+	 */
+	textrows = win->w_nrows - 1;
+	row = linerow(win->w_cursor);
+	skip = (topline == currline) ? win->w_skiprows : 0;
+	if (row < skip) {
+	    skip = (skip - row > halfwinsize) ? row - halfwinsize : row;
+	    if (skip < 0) {
+		skip = 0;
+	    }
+	} else if (row >= skip + textrows) {
+	    skip = row - textrows + 1;
+	    if (row >= skip + textrows + halfwinsize) {
+		skip = row - halfwinsize;
+	    }
+	}
+	if (skip > plines(currline) - textrows) {
+	    skip = plines(currline) - textrows;
+	}
+	if (topline != currline || skip != win->w_skiprows) {
+	    win->w_topline = currline;
+	    win->w_skiprows = skip;
+	    redraw_window(FALSE);
+	    if (topline != currline) {
+		info_update();
+	    }
+	}
+
     } else if (earlier(currline, topline)) {
 	long	nlines;
 
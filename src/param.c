@@ -115,9 +115,10 @@ static	matchinfo_t	*findparam P((char *));
 /*
  * These are the available parameters. The following are non-standard:
  *
- *	autodetect autosplit colour edit
+ *	adapttimeout autodetect autosplit colour edit
  *	format helpfile infoupdate jumpscroll preserve preservetime
- *	regextype roscolour statuscolour systemcolour tabindent vbell
+ *	regextype roscolour statuscolour syncupdate systemcolour
+ *	tabindent vbell wrap
  *
  * The string/list value field of Param[] is left uninitialized and gets NULL.
  *
@@ -127,6 +128,7 @@ Param	params[] = {
 /*  fullname        shortname       flags       value           function ... */
 {   "ada",          "ada",          P_BOOL,     0,              not_imp,   },
 {   "adapath",      "adap",         P_STRING,   0,              not_imp,   },
+{   "adapttimeout", "at",           P_BOOL,     FALSE,          nofunc,    },
 {   "autodetect",   "ad",           P_BOOL,     0,              nofunc,    },
 {   "autoindent",   "ai",           P_BOOL,     0,              nofunc,    },
 {   "autoprint",    "ap",           P_BOOL,     0,              not_imp,   },
@@ -177,6 +179,7 @@ Param	params[] = {
 {   "slowopen",     "sl",           P_BOOL,     0,              not_imp,   },
 {   "sourceany",    "so",           P_BOOL,     0,              not_imp,   },
 {   "statuscolour", "st",           P_STRING,   0,              xvpSetColour,},
+{   "syncupdate",   "su",           P_BOOL,     FALSE,          nofunc,    },
 {   "systemcolour", "sy",           P_STRING,   0,              xvpSetColour,},
 {   "tabindent",    "tabindent",    P_BOOL,     TRUE,           nofunc,    },
 {   "tabs",         "tabs",         P_BOOL,     TRUE,           nofunc,    },
@@ -190,6 +193,7 @@ Param	params[] = {
 {   "vbell",        "vb",           P_BOOL,     FALSE,          xvpSetVBell, },
 {   "warn",         "war",          P_BOOL,     TRUE,           nofunc,    },
 {   "window",       "wi",           P_NUM,      0,              not_imp,   },
+{   "wrap",         "wrap",         P_BOOL,     TRUE,           nofunc,    },
 {   "wrapmargin",   "wm",           P_NUM,      0,              nofunc,    },
 {   "wrapscan",     "ws",           P_BOOL,     TRUE,           nofunc,    },
 {   "writeany",     "wa",           P_BOOL,     0,              nofunc,    },
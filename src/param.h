@@ -116,6 +116,7 @@ extern	Param	params[];
 enum {
     P_ada = 0,
     P_adapath,
+    P_adapttimeout,
     P_autodetect,
     P_autoindent,
     P_autoprint,
@@ -166,6 +167,7 @@ enum {
     P_slowopen,
     P_sourceany,
     P_statuscolour,
+    P_syncupdate,
     P_systemcolour,
     P_tabindent,
     P_tabs,
@@ -179,6 +181,7 @@ enum {
     P_vbell,
     P_warn,
     P_window,
+    P_wrap,
     P_wrapmargin,
     P_wrapscan,
     P_writeany,
@@ -218,7 +218,10 @@ FILE	*fp;
 	case at_soln:
 	case in_line:
 	    if (col >= lp->l_size - 1) {
-		if (!lnresize(lp, col + 2)) {
+		/*
+		 * Grow long lines by half as much again, as readfile() does.
+		 */
+		if (!lnresize(lp, col + col / 2 + 2)) {
 		    if (lptr != NULL)
 			throw(lptr);
 		    return(-1);
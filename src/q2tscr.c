@@ -85,6 +85,9 @@ VirtScr	qnxscr = {
     NOFUNC,		/* v_insert	    */
     NOFUNC,		/* v_scroll	    */
     NOFUNC,		/* v_can_scroll     */
+    NOFUNC,		/* v_delete	    */
+    NOFUNC,		/* v_insdel_cost    */
+    NOFUNC,		/* v_stats	    */
 };
 
 int			qnx_disp_inited = 0;
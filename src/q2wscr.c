@@ -705,6 +705,9 @@ scr_init(void)
     vs->v_insert = NULL;
     vs->v_scroll = scroll;
     vs->v_can_scroll = NULL;
+    vs->v_delete = NULL;
+    vs->v_insdel_cost = NULL;
+    vs->v_stats = NULL;
 
     return(vs);
 }
@@ -21,10 +21,228 @@
 
 #include "xvi.h"
 
+/*
+ * The display form of a line, with tabs expanded, control characters
+ * made visible and the '$' added in list mode, is kept with the line
+ * so that a redraw only has to copy it if the line has not changed.
+ * It does not depend on the window width or the number parameter,
+ * which only affect where it is put on the screen.
+ *
+ * Lines which have only been measured, and not displayed, just have
+ * their width recorded; that is all plines() needs.
+ */
+typedef struct linecells {
+    unsigned long	lc_version;	/* l_version it was made from */
+    int			lc_key;		/* CELLKEY() it was made with */
+    int			lc_width;	/* number of cells in display form */
+    int			lc_lasttab;	/* index of last tab in line, or -1 */
+    bool_t		lc_hascells;	/* TRUE if they are in lc_cells */
+    int			lc_size;	/* space available in lc_cells */
+    char		lc_cells[1];	/* really lc_size bytes long */
+} LineCells;
+
+static	LineCells *valid_cells P((Line *, int));
+static	char	*line_cells P((Line *, int *));
 static	int	line_to_new P((Line *, int, long));
+static	int	slice_to_new P((Line *, int, long, int, int));
 static	void	file_to_new P((void));
 static	void	do_sline P((void));
 
+/*
+ * Return the display information kept with the given line if it is
+ * still valid for the given key, otherwise NULL.
+ */
+static LineCells *
+valid_cells(lp, key)
+Line	*lp;
+int	key;
+{
+    register LineCells	*lc = lp->l_cells;
+
+    if (lc != NULL && lc->lc_version == lp->l_version && lc->lc_key == key) {
+	return(lc);
+    }
+    return(NULL);
+}
+
+/*
+ * Return the number of screen cells needed to show the given line,
+ * not counting any line number.
+ */
+int
+line_width(lp)
+Line	*lp;
+{
+    register LineCells	*lc;
+    register char	*ltext;
+    int			key;
+    int			width;
+    int			lasttab;
+
+    key = CELLKEY();
+    lc = valid_cells(lp, key);
+    if (lc != NULL) {
+	return(lc->lc_width);
+    }
+
+    width = 0;
+    lasttab = -1;
+    for (ltext = lp->l_text; *ltext != '\0'; ltext++) {
+	if (*ltext == '\t') {
+	    lasttab = ltext - lp->l_text;
+	}
+	width += vischar((int) (unsigned char) *ltext, (char **) NULL, width);
+    }
+    if (Pb(P_list)) {
+	width++;
+    }
+
+    /*
+     * Record the width with the line. If its display form is
+     * out of date, it is forgotten; it will be made again when
+     * the line is next displayed.
+     */
+    lc = lp->l_cells;
+    if (lc == NULL) {
+	lc = (LineCells *) malloc(sizeof(LineCells));
+	lp->l_cells = lc;
+	if (lc == NULL) {
+	    return(width);
+	}
+	lc->lc_size = 0;
+    }
+    lc->lc_version = lp->l_version;
+    lc->lc_key = key;
+    lc->lc_width = width;
+    lc->lc_lasttab = lasttab;
+    lc->lc_hascells = FALSE;
+    return(width);
+}
+
+/*
+ * Called by _replchars() after it has put the nnew characters at start
+ * in the given line in place of the old ones (and incremented l_version).
+ * If the line's width was known before, and no tab was involved whose
+ * width could have changed, the new width is worked out from just the
+ * characters which changed, so that typing into a long line doesn't
+ * need it to be measured again for each character. Since we know
+ * where the line's last tab is, nor do we need to look at the text
+ * after the change.
+ */
+void
+cells_replaced(lp, start, nnew, old)
+Line	*lp;
+int	start;
+int	nnew;
+char	*old;
+{
+    register LineCells	*lc = lp->l_cells;
+    register char	*p;
+    char		*end;
+    int			width;
+
+    /*
+     * A tab at or after start, including any among the old
+     * characters, may now have a different width.
+     */
+    if (lc == NULL || lc->lc_version != lp->l_version - 1 ||
+		    lc->lc_key != CELLKEY() || lc->lc_lasttab >= start) {
+	return;
+    }
+
+    width = lc->lc_width;
+    for (p = old; *p != '\0'; p++) {
+	width -= vischar((int) (unsigned char) *p, (char **) NULL, -1);
+    }
+    end = lp->l_text + start + nnew;
+    for (p = lp->l_text + start; p < end; p++) {
+	if (*p == '\t') {
+	    return;
+	}
+	width += vischar((int) (unsigned char) *p, (char **) NULL, -1);
+    }
+
+    lc->lc_version = lp->l_version;
+    lc->lc_width = width;
+    lc->lc_hascells = FALSE;
+}
+
+/*
+ * Return the display form of the given line, and set *ncellsp to its
+ * length. The result is cached with the line, or if there is not enough
+ * memory for that it is in a static buffer valid until the next call.
+ */
+static char *
+line_cells(lp, ncellsp)
+Line	*lp;
+int	*ncellsp;
+{
+    static Flexbuf	cells;
+    register LineCells	*lc;
+    register char	*ltext;
+    register unsigned	n;
+    char		*p;
+    int			key;
+    int			vcol;
+    int			ncells;
+    int			lasttab;
+
+    key = CELLKEY();
+    lc = valid_cells(lp, key);
+    if (lc != NULL && lc->lc_hascells) {
+	*ncellsp = lc->lc_width;
+	return(lc->lc_cells);
+    }
+    lc = lp->l_cells;
+
+    flexclear(&cells);
+    vcol = 0;
+    lasttab = -1;
+    for (ltext = lp->l_text; *ltext != '\0'; ltext++) {
+	if (*ltext == '\t') {
+	    lasttab = ltext - lp->l_text;
+	}
+	n = vischar((int) (unsigned char) *ltext, &p, vcol);
+	vcol += n;
+	while (n-- > 0) {
+	    (void) flexaddch(&cells, *p++);
+	}
+    }
+    if (Pb(P_list)) {
+	/*
+	 * Have to show a '$' sign in list mode.
+	 */
+	(void) flexaddch(&cells, '$');
+    }
+    ncells = flexlen(&cells);
+    *ncellsp = ncells;
+
+    /*
+     * Keep a copy with the line, reusing the old one if it is big enough.
+     * Failure is not an error; we will just have to do this again.
+     */
+    if (lc == NULL || lc->lc_size < ncells) {
+	if (lc != NULL) {
+	    free((genptr *) lc);
+	}
+	lc = (LineCells *) malloc(sizeof(LineCells) + ncells);
+	lp->l_cells = lc;
+	if (lc == NULL) {
+	    return(flexgetstr(&cells));
+	}
+	lc->lc_size = ncells;
+    }
+    lc->lc_version = lp->l_version;
+    lc->lc_key = key;
+    lc->lc_width = ncells;
+    lc->lc_lasttab = lasttab;
+    lc->lc_hascells = TRUE;
+    if (ncells > 0) {
+	(void) memcpy(lc->lc_cells, flexgetstr(&cells), (size_t) ncells);
+    }
+    return(lc->lc_cells);
+}
+
 /*
  * Transfer the specified window line into the "new" screen array, at
  * the given row. Returns the number of screen lines taken up by the
@@ -39,27 +257,55 @@ int		start_row;
 long		line;
 {
     Xviwin		*win = curwin;
-    register unsigned	c;		/* next character from file */
     register Sline	*curr_line;	/* output line - used for efficiency */
-    register char	*ltext;		/* pointer to text of line */
-    register int	curr_index;	/* current index in line */
-    bool_t		eoln;		/* true when line is done */
-    char		extra[MAX_TABSTOP];
-					/* Stack for extra characters. */
-    int			nextra = 0;	/* index into stack */
+    register char	*cells;		/* display form of the line */
+    int			ncells;		/* number of cells left in it */
+    register int	n;		/* number of cells to copy */
     int			srow, scol;	/* current screen row and column */
-    int			vcol;		/* virtual column */
-    int			norm_colour_pos;/* pos where we switch off highlight */
-    unsigned		colour;		/* current plotting colour */
 
-    ltext = lp->l_text;
+    /*
+     * With wrap unset, each line takes one row,
+     * showing the columns from w_leftcol onwards.
+     */
+    if (!Pb(P_wrap)) {
+	return(slice_to_new(lp, start_row, line, win->w_leftcol,
+							start_row + 1));
+    }
+
+    /*
+     * A line which is too big for the window is shown from
+     * the row containing the cursor when it is at the top;
+     * anywhere else, it is not shown at all.
+     */
+    if (plines(lp) > win->w_cmdline - start_row) {
+	if (lp == win->w_topline && start_row == win->w_winpos) {
+	    int	startcol;
+
+	    startcol = (int) win->w_skiprows * win->w_ncols;
+	    if (Pb(P_number) && startcol > 0) {
+		startcol -= NUM_SIZE;
+	    }
+	    return(slice_to_new(lp, start_row, line, startcol,
+						    (int) win->w_cmdline));
+	}
+	for (srow = start_row; srow < win->w_cmdline; srow++) {
+	    curr_line = win->w_vs->pv_int_lines + srow;
+
+	    curr_line->s_flags = S_MARKER;
+	    curr_line->s_used = 1;
+	    curr_line->s_line[0] = '@';
+	    curr_line->s_line[1] = '\0';
+	    curr_line->s_colour[0] = VSCcolour;
+	    xvMarkDirty(srow);
+	}
+	return(0);
+    }
+
+    cells = line_cells(lp, &ncells);
+
     srow = start_row;
-    scol = vcol = 0;
+    scol = 0;
     curr_line = win->w_vs->pv_int_lines + srow;
-    curr_index = 0;
-    norm_colour_pos = 0;
-    colour = VSCcolour;
-    eoln = FALSE;
 
     if (Pb(P_number)) {
 	static Flexbuf	ftmp;
@@ -73,79 +319,116 @@ long		line;
 	/* assert: scol == NUM_SIZE */
     }
 
-    while (!eoln) {
+    while (ncells > 0) {
 	/*
-	 * Get the next character to put on the screen.
+	 * Sline folding.
 	 */
+	if (scol >= win->w_ncols) {
+	    curr_line->s_flags = S_TEXT;
+	    curr_line->s_used = scol;
+	    curr_line->s_line[scol] = '\0';
+	    xvMarkDirty(srow);
+	    srow += 1;
+	    scol = 0;
+	    curr_line = win->w_vs->pv_int_lines + srow;
+	}
 
 	/*
-	 * "extra" is a stack containing any extra characters
-	 * we have to put on the screen - this is for chars
-	 * which have a multi-character representation, and
-	 * for the $ at end-of-line in list mode.
+	 * Copy as much as fits on this screen line into int_lines.
 	 */
+	n = win->w_ncols - scol;
+	if (n > ncells) {
+	    n = ncells;
+	}
+	(void) memcpy(curr_line->s_line + scol, cells, (size_t) n);
+	(void) memset((char *) curr_line->s_colour + scol, VSCcolour,
+								(size_t) n);
+	cells += n;
+	ncells -= n;
+	scol += n;
+    }
 
-	if (nextra > 0) {
-	    c = extra[--nextra];
-	} else {
-	    unsigned	n;
+    /*
+     * End of line. Terminate it and finish.
+     */
+    curr_line->s_flags = S_TEXT;
+    curr_line->s_used = scol;
+    curr_line->s_line[scol] = '\0';
+    xvMarkDirty(srow);
 
-	    if (curr_index == norm_colour_pos) {
-		colour = VSCcolour;
-	    }
+    return((srow - start_row) + 1);
+}
 
-	    c = (unsigned char) (ltext[curr_index++]);
+/*
+ * Show part of a line, starting at the given virtual column, on the
+ * screen rows from start_row up to (but not including) end_row; the
+ * line number is shown if it is wanted and the slice starts at the
+ * beginning of the line or wrap is unset. This is used for lines which
+ * are too big for the window, and for all lines if wrap is unset.
+ * Only the visible part of the line is looked at: the first character
+ * shown is found from the column checkpoints kept by colindex().
+ * Returns the number of screen rows used.
+ */
+static int
+slice_to_new(lp, start_row, line, startcol, end_row)
+Line		*lp;
+int		start_row;
+long		line;
+int		startcol;
+int		end_row;
+{
+    Xviwin		*win = curwin;
+    register Sline	*curr_line;	/* output line - used for efficiency */
+    register char	*ltext;		/* pointer to text of line */
+    register unsigned	n;		/* number of cells for a character */
+    char		*p;		/* the cells themselves */
+    int			index;		/* current index in line */
+    int			srow, scol;	/* current screen row and column */
+    int			vcol;		/* virtual column */
+    int			drop;		/* cells of first char not shown */
+    bool_t		dollar;		/* list mode '$' has been shown */
 
-	    /*
-	     * Deal with situations where it is not
-	     * appropriate just to copy characters
-	     * straight onto the screen.
-	     */
-	    if (c == '\0') {
-
-		if (Pb(P_list)) {
-		    /*
-		     * Have to show a '$' sign in list mode.
-		     */
-		    extra[nextra++] = '\0';
-		    c = '$';
-		}
+    srow = start_row;
+    scol = 0;
+    curr_line = win->w_vs->pv_int_lines + srow;
 
-	    } else {
-		char	*p;
-
-		n = vischar((int) c, &p, vcol);
-		/*
-		 * This is a bit paranoid assuming
-		 * that Pn(P_tabstop) can never be
-		 * greater than sizeof (extra), but
-		 * so what.
-		 */
-		if (nextra + n > sizeof extra) {
-		    n = sizeof(extra) - nextra;
-		}
-		/*
-		 * Stack the extra characters so that
-		 * they appear in the right order.
-		 */
-		while (n > 1) {
-		    extra[nextra++] = p[--n];
-		}
-		c = p[0];
-	    }
+    if (Pb(P_number) && (startcol == 0 || !Pb(P_wrap))) {
+	static Flexbuf	ftmp;
+
+	flexclear(&ftmp);
+	(void) lformat(&ftmp, NUM_FMT, line);
+	(void) strcpy(curr_line->s_line, flexgetstr(&ftmp));
+	for (scol = 0; scol < NUM_SIZE; scol++) {
+	    curr_line->s_colour[scol] = VSCcolour;
 	}
+    }
 
-	if (c == '\0') {
+    ltext = lp->l_text;
+    index = colindex(lp, startcol, &vcol);
+    drop = startcol - vcol;
+    dollar = FALSE;
+
+    for (;;) {
+	if (ltext[index] != '\0') {
+	    n = vischar((int) (unsigned char) ltext[index++], &p, vcol);
+	    vcol += n;
+	} else if (Pb(P_list) && !dollar) {
 	    /*
-	     * End of line. Terminate it and finish.
+	     * Have to show a '$' sign in list mode.
 	     */
-	    eoln = TRUE;
-	    curr_line->s_flags = S_TEXT;
-	    curr_line->s_used = scol;
-	    curr_line->s_line[scol] = '\0';
-	    xvMarkDirty(srow);
-	    break;
+	    p = "$";
+	    n = 1;
+	    dollar = TRUE;
 	} else {
+	    break;
+	}
+
+	for ( ; n > 0; n--, p++) {
+	    if (drop > 0) {
+		drop--;
+		continue;
+	    }
+
 	    /*
 	     * Sline folding.
 	     */
@@ -156,33 +439,23 @@ long		line;
 		xvMarkDirty(srow);
 		srow += 1;
 		scol = 0;
-		curr_line = win->w_vs->pv_int_lines + srow;
-	    }
-
-	    if (srow >= win->w_cmdline) {
-		for (srow = start_row; srow < win->w_cmdline; srow++) {
-		    curr_line = win->w_vs->pv_int_lines + srow;
-
-		    curr_line->s_flags = S_MARKER;
-		    curr_line->s_used = 1;
-		    curr_line->s_line[0] = '@';
-		    curr_line->s_line[1] = '\0';
-		    curr_line->s_colour[0] = VSCcolour;
-		    xvMarkDirty(srow);
+		if (srow >= end_row) {
+		    return(srow - start_row);
 		}
-		return(0);
+		curr_line = win->w_vs->pv_int_lines + srow;
 	    }
 
-	    /*
-	     * Store the character in int_lines.
-	     */
-	    curr_line->s_line[scol] = c;
-	    curr_line->s_colour[scol] = colour;
+	    curr_line->s_line[scol] = *p;
+	    curr_line->s_colour[scol] = VSCcolour;
 	    scol++;
-	    vcol++;
 	}
     }
 
+    curr_line->s_flags = S_TEXT;
+    curr_line->s_used = scol;
+    curr_line->s_line[scol] = '\0';
+    xvMarkDirty(srow);
+
     return((srow - start_row) + 1);
 }
 
@@ -493,6 +766,33 @@ bool_t	clrflag;
     xvUpdateScr(0, (int) VSrows(vs));
 }
 
+/*
+ * Bring the whole screen up to date after updates have been deferred.
+ * This is like redraw_all(FALSE), except that the status lines are
+ * left as they are in the internal screen image, since they may hold
+ * a message or the command line.
+ */
+void
+redraw_deferred()
+{
+    Xviwin	*savecurwin;
+    VirtScr	*vs = curwin->w_vs;
+
+    if ((VSrows(vs) < Pn(P_minrows)) || (VScols(vs) == 0)) {
+	return;
+    }
+
+    savecurwin = curwin;
+    do {
+	if (curwin->w_nrows >= Pn(P_minrows)) {
+	    file_to_new();
+	}
+        set_curwin(xvNextDisplayedWindow(curwin));
+    } while (curwin != savecurwin);
+
+    xvUpdateScr(0, (int) VSrows(vs));
+}
+
 /*
  * The rest of the routines in this file perform screen manipulations.
  * The given operation is performed physically on the screen. The
@@ -775,6 +1075,14 @@ int			newchar;
 	return;
     }
 
+    /*
+     * Nor if the line is scrolled sideways,
+     * since tabs would then be the wrong width.
+     */
+    if (!Pb(P_wrap) && curwin->w_leftcol != 0) {
+	return;
+    }
+
     nchars = vischar(newchar, &newstr, (int) curcol);
 
     /*
@@ -21,6 +21,58 @@
 
 #include "xvi.h"
 
+#ifdef	POSIX
+#   include <sys/types.h>
+#   include <sys/stat.h>
+#   include <sys/mman.h>
+#   define	MMAP_TAGS	/* binary-search sorted tags files in place */
+#   if defined(_POSIX_THREADS) && !defined(NO_TAG_THREADS)
+#	include <pthread.h>
+#	define	TAG_THREADS	/* load tags files in the background */
+#	ifdef	HAVE_WATCHFD
+#	    include <unistd.h>
+#	    include <fcntl.h>
+#	    define TAG_NOTIFY	/* loader tells us when it has finished */
+#	endif
+#   endif
+#endif
+
+#ifdef	MMAP_TAGS
+/*
+ * An unsorted tags file is searched through an index of the offsets
+ * of its lines, sorted by tag name. The index is saved in a file
+ * beside the tags file (or in the user's cache directory if that is
+ * not writable) and reused by later invocations for as long as the
+ * tags file is the same file, with the same size and modification time.
+ * The offsets in it are checked when it is loaded, so that a stale or
+ * damaged index can't make us look outside the tags file.
+ */
+#define	IDX_MAGIC	"xvitagx2"
+#define	IDX_PREFIX	"."		/* index of "tags" is ".tags.xvi" */
+#define	IDX_SUFFIX	".xvi"
+#define	IDX_CACHEDIR	".cache"	/* relative to $HOME */
+#define	IDX_NAMESIZE	(MAXPATHLEN * 2 + 1)
+
+typedef struct tagidxhdr {
+    char		ti_magic[8];	/* IDX_MAGIC */
+    unsigned long	ti_dev;		/* device of tags file */
+    unsigned long	ti_ino;		/* inode number of tags file */
+    unsigned long	ti_size;	/* size of tags file */
+    unsigned long	ti_mtime;	/* modification time of tags file */
+    unsigned long	ti_mnsec;	/* and its nanoseconds, if known */
+    unsigned long	ti_count;	/* number of offsets which follow */
+} TAGIDXHDR;
+
+/*
+ * POSIX.1-2008 gives modification times to the nanosecond.
+ */
+#if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200809L
+#   define	ST_MNSEC(stp)	((unsigned long) (stp)->st_mtim.tv_nsec)
+#else
+#   define	ST_MNSEC(stp)	0L
+#endif
+#endif
+
 #define	LSIZE		512	/* max. size of a line in the tags file */
 
 /*
@@ -31,47 +83,411 @@
 
 /*
  * New dynamic tags stuff.
+ *
+ * Tags from files that are not mapped into memory are kept in an
+ * open-addressed hash table with linear probing, whose size is a power
+ * of two and which is doubled whenever it gets three-quarters full.
+ * The text of all of them is kept in an arena of large blocks, which
+ * is only ever freed as a whole.
  */
-static	TAG	**hashtable = NULL;
-static	int	hashtabsize = 1009;	/* should be a prime; e.g. 2003 is ok */
+typedef struct tagslot {
+    unsigned long	ts_hash;	/* hash value of ts_tag.t_name */
+    TAG			ts_tag;		/* t_name is NULL if slot unused */
+} TAGSLOT;
+
+#define	HASH_MINSIZE	1024
+
+/*
+ * FNV-1a hash, one character at a time.
+ */
+#define	HASH_INIT	2166136261UL
+#define	HASH_STEP(f, c)	((((f) ^ (unsigned char) (c)) * 16777619UL) \
+							& 0xffffffffUL)
+
+typedef struct tagarena {
+    struct tagarena	*ta_next;
+    size_t		ta_used;	/* bytes used in ta_text */
+    size_t		ta_size;	/* bytes available in ta_text */
+    char		ta_text[1];	/* really ta_size bytes long */
+} TAGARENA;
+
+#define	ARENA_BLOCK	65536
 
-static	void	EnterTag P((char *));
-static	void	tagFree P((void));
+/*
+ * One of these is kept for each tags file that we managed to open,
+ * in the order they are given in the tags parameter, so that the
+ * first file to define a tag wins.
+ *
+ * Files whose header says that they are sorted are mapped into memory
+ * and binary-searched in place, which avoids reading huge tags files
+ * just to look up one name; other files are mapped and searched through
+ * a sorted index. Files which cannot be mapped go into the hash table.
+ */
+typedef struct tagfile {
+    struct tagfile	*tf_next;
+    char		*tf_map;	/* mapped text, or NULL if hashed */
+    size_t		tf_size;	/* size of mapped text */
+    unsigned long	*tf_index;	/* sorted line offsets, or NULL */
+    unsigned long	tf_count;	/* number of entries in tf_index */
+    char		*tf_imap;	/* mapped index file, or NULL */
+    size_t		tf_isize;	/* size of mapped index file */
+} TAGFILE;
+
+/*
+ * Everything loaded for one setting of the tags and taglength
+ * parameters. Whenever either of them changes, a new cache is built
+ * from scratch, in a separate thread if we have them, and it only
+ * replaces the old one once it is complete. So none of the code which
+ * fills one in may use the screen, the parameters or alloc().
+ */
+typedef struct tagcache {
+    char		**tc_names;	/* expanded names of tags files */
+    int			tc_maxchars;	/* taglength, or INT_MAX */
+    TAGFILE		*tc_files;	/* tags files that could be opened */
+    TAGSLOT		*tc_table;	/* hash table for unmapped files */
+    unsigned long	tc_tabsize;	/* number of slots in tc_table */
+    unsigned long	tc_tabcount;	/* number of them in use */
+    TAGARENA		*tc_arena;	/* text of the tags in tc_table */
+    struct tagcache	*tc_old;	/* superseded cache, to be freed */
+#ifdef	TAG_THREADS
+    bool_t		tc_waitprev;	/* must wait for tc_prevloader */
+    pthread_t		tc_prevloader;	/* superseded loader thread */
+#endif
+} TAGCACHE;
+
+static	TAGCACHE	*tagcache = NULL;	/* the one lookups use */
+static	bool_t		tagswanted = FALSE;	/* tagInit() has been called */
+static	bool_t		tagsstale = TRUE;	/* parameters have changed */
+
+#ifdef	TAG_THREADS
+static	pthread_t	tagloader;		/* thread building next cache */
+static	bool_t		tagloading = FALSE;	/* TRUE until it is joined */
+#endif
+
+#ifdef	TAG_NOTIFY
+/*
+ * When a loader thread has finished, it writes a pointer to the cache
+ * it built down this pipe. The main loop watches the other end while
+ * waiting for input, so we can join the thread as soon as it is done
+ * instead of when the next lookup comes along.
+ */
+static	int		tagpipe[2] = { -1, -1 };
+static	TAGCACHE	*tagnext = NULL;	/* what tagloader is building */
+#endif
+
+/*
+ * The last tag found by binary search; it belongs to us and is freed
+ * on the next lookup.
+ */
+static	TAG	*mappedtag = NULL;
 
+/*
+ * Statistics for the ":tagstats" command.
+ */
+static	unsigned long	ts_lookups;	/* calls to tagLookup() for a name */
+static	unsigned long	ts_hits;	/* ... which found the tag */
+static	unsigned long	ts_waits;	/* ... which had to wait for loading */
+static	unsigned long	ts_hprobes;	/* slots examined in the hash table */
+static	unsigned long	ts_hsearches;	/* searches of the hash table */
+static	unsigned long	ts_hmaxprobe;	/* longest search of the hash table */
+static	unsigned long	ts_bprobes;	/* lines examined by binary search */
+
+static	TAGCACHE *NewTagCache P((void));
+static	void	StartTagLoad P((void));
+static	genptr	*TagLoader P((genptr *));
+static	void	LoadTagCache P((TAGCACHE *));
+static	void	FreeTagCache P((TAGCACHE *));
+static	TAGCACHE *CurrentTags P((void));
+#ifdef	TAG_THREADS
+static	void	JoinTagLoader P((void));
+#endif
+#ifdef	TAG_NOTIFY
+static	void	TagLoaded P((int, genptr *));
+#endif
+static	void	ParseTag P((char *, TAG *, int));
+static	TAG	*MakeTag P((char *, int));
+static	char	*ArenaAlloc P((TAGCACHE *, size_t));
+static	bool_t	GrowHashTable P((TAGCACHE *));
+static	void	EnterTag P((TAGCACHE *, char *));
+static	char	*tagStatLine P((void));
+#ifdef	MMAP_TAGS
+static	bool_t	MapTagFile P((FILE *, char *, TAGFILE *));
+static	TAG	*SearchTagFile P((TAGFILE *, char *, int, int));
+static	bool_t	AddName P((char *, size_t, char *, bool_t));
+static	bool_t	IndexName P((char *, char *, bool_t));
+static	bool_t	LoadTagIndex P((TAGFILE *, char *, struct stat *));
+static	bool_t	CheckTagIndex P((TAGFILE *, unsigned long *, unsigned long));
+static	bool_t	BuildTagIndex P((TAGFILE *));
+static	void	SaveTagIndex P((TAGFILE *, char *, struct stat *));
+static	void	FreeTagFile P((TAGFILE *));
+static	TAG	*MappedTag P((TAGFILE *, unsigned long, int));
+#endif
+
+/*
+ * Start loading the tags files. This is called once at startup, after
+ * the parameters have been set from the environment and .exrc files.
+ */
 void
 tagInit()
 {
-    char		**tagfiles;
+    tagswanted = TRUE;
+    if (tagsstale) {
+	StartTagLoad();
+    }
+}
+
+/*
+ * If the tags parameters have changed since the tags were last loaded,
+ * start loading them again. This is called after each event, because
+ * tagSetParam() is called before the new value has been set.
+ */
+void
+tagCheckLoad()
+{
+    if (tagswanted && tagsstale) {
+	StartTagLoad();
+    }
+}
+
+/*
+ * Make a new, empty tag cache for the current parameter values.
+ * Filename expansion may need a shell, so it is done here and not
+ * by the loader.
+ */
+static TAGCACHE *
+NewTagCache()
+{
+    TAGCACHE	*tc;
+    char	**tagnames;
+    int		count;
+
+    tc = clr_alloc(1, sizeof(TAGCACHE));
+    if (tc == NULL) {
+	return(NULL);
+    }
+    tc->tc_maxchars = Pn(P_taglength);
+    if (tc->tc_maxchars == 0) {
+	tc->tc_maxchars = INT_MAX;
+    }
+
+    tagnames = Pl(P_tags);
+    count = 0;
+    if (tagnames != NULL) {
+	while (tagnames[count] != NULL) {
+	    count++;
+	}
+    }
+    tc->tc_names = clr_alloc((size_t) count + 1, sizeof(char *));
+    if (tc->tc_names == NULL) {
+	free(tc);
+	return(NULL);
+    }
+    for (count = 0; tagnames != NULL && tagnames[count] != NULL; count++) {
+	tc->tc_names[count] = strsave(fexpand(tagnames[count], FALSE));
+	if (tc->tc_names[count] == NULL) {
+	    break;
+	}
+    }
+    return(tc);
+}
+
+/*
+ * Replace the current tag cache with a new one. The old one can't be
+ * used any more, because the parameters have changed, so it is handed
+ * to the loader to free, as is the result of any load still running.
+ */
+static void
+StartTagLoad()
+{
+    TAGCACHE	*tc;
+
+    tc = NewTagCache();
+    if (tc == NULL) {
+	return;
+    }
+    tagsstale = FALSE;
+    tc->tc_old = tagcache;
+    tagcache = NULL;
+
+#ifdef	TAG_THREADS
+    {
+	sigset_t	allsigs, oldsigs;
+	int		error;
+
+	tc->tc_waitprev = tagloading;
+	tc->tc_prevloader = tagloader;
+
+#ifdef	TAG_NOTIFY
+	if (tagpipe[0] < 0 && pipe(tagpipe) == 0) {
+	    (void) fcntl(tagpipe[0], F_SETFD, FD_CLOEXEC);
+	    (void) fcntl(tagpipe[1], F_SETFD, FD_CLOEXEC);
+	    if (!sys_watchfd(tagpipe[0], TagLoaded, (genptr *) NULL)) {
+		(void) close(tagpipe[0]);
+		(void) close(tagpipe[1]);
+		tagpipe[0] = tagpipe[1] = -1;
+	    }
+	}
+	tagnext = tc;
+#endif
+
+	/*
+	 * Signals must be delivered to the main thread, so the
+	 * loader is created with all of them blocked.
+	 */
+	(void) sigfillset(&allsigs);
+	(void) pthread_sigmask(SIG_BLOCK, &allsigs, &oldsigs);
+	error = pthread_create(&tagloader, (pthread_attr_t *) NULL,
+						TagLoader, (genptr *) tc);
+	(void) pthread_sigmask(SIG_SETMASK, &oldsigs, (sigset_t *) NULL);
+	if (error == 0) {
+	    tagloading = TRUE;
+	    return;
+	}
+	tagloading = FALSE;
+    }
+#endif
+
+    tagcache = (TAGCACHE *) TagLoader((genptr *) tc);
+}
+
+/*
+ * Build a tag cache; this is the body of the loader thread. First get
+ * rid of the caches it supersedes, which nobody else can be using.
+ */
+static genptr *
+TagLoader(arg)
+genptr	*arg;
+{
+    TAGCACHE	*tc = (TAGCACHE *) arg;
+
+#ifdef	TAG_THREADS
+    if (tc->tc_waitprev) {
+	genptr	*prev;
+
+	if (pthread_join(tc->tc_prevloader, &prev) == 0) {
+	    FreeTagCache((TAGCACHE *) prev);
+	}
+	tc->tc_waitprev = FALSE;
+    }
+#endif
+    FreeTagCache(tc->tc_old);
+    tc->tc_old = NULL;
+
+    LoadTagCache(tc);
+#ifdef	TAG_NOTIFY
+    if (tagpipe[1] >= 0) {
+	(void) write(tagpipe[1], (char *) &tc, sizeof(tc));
+    }
+#endif
+    return((genptr *) tc);
+}
+
+/*
+ * Return the tag cache to use for lookups, waiting for it to be loaded
+ * if necessary, or NULL if there isn't one.
+ */
+static TAGCACHE *
+CurrentTags()
+{
+    if (tagsstale) {
+	StartTagLoad();
+    }
+#ifdef	TAG_THREADS
+    if (tagloading) {
+	ts_waits++;
+	JoinTagLoader();
+    }
+#endif
+    return(tagcache);
+}
+
+#ifdef	TAG_THREADS
+/*
+ * Wait for the loader thread to finish, and use what it loaded.
+ */
+static void
+JoinTagLoader()
+{
+    genptr	*result;
+
+    if (tagloading) {
+	if (pthread_join(tagloader, &result) == 0) {
+	    tagcache = (TAGCACHE *) result;
+	}
+	tagloading = FALSE;
+    }
+}
+#endif
+
+#ifdef	TAG_NOTIFY
+/*
+ * Called from the main loop when a loader has written to tagpipe.
+ * Superseded loaders are joined by their successors, so we only
+ * join the thread if it is the current one.
+ */
+/*ARGSUSED*/
+static void
+TagLoaded(fd, arg)
+int	fd;
+genptr	*arg;
+{
+    TAGCACHE	*done[8];
+    int		n;
+    int		i;
+
+    n = read(fd, (char *) done, sizeof(done));
+    for (i = 0; i < n / (int) sizeof(done[0]); i++) {
+	if (tagloading && done[i] == tagnext) {
+	    JoinTagLoader();
+	}
+    }
+}
+#endif
+
+/*
+ * Open all the tags files for a cache, mapping them into memory
+ * if possible and reading them into the hash table if not.
+ */
+static void
+LoadTagCache(tc)
+TAGCACHE	*tc;
+{
     int			count;
     char		inbuf[LSIZE];
     register FILE	*fp;
     register char	*cp;
     register int	c;
+    char		*fname;
+    TAGFILE		*tfp;
+    TAGFILE		**tfpp;
 
-    tagfiles = Pl(P_tags);
-    if (tagfiles == NULL) {
-	return;
-    }
+    tfpp = &tc->tc_files;
+    for (count = 0; tc->tc_names[count] != NULL; count++) {
 
-    if (hashtable != NULL) {
-	return;			/* Already initialised */
-    }
+	fname = tc->tc_names[count];
+	fp = fopen(fname, "r");
+	if (fp == NULL) {
+	    continue;
+	}
 
-    for (count = 0; tagfiles[count] != NULL; count++) {
+	tfp = calloc(1, sizeof(TAGFILE));
+	if (tfp == NULL) {
+	    (void) fclose(fp);
+	    return;
+	}
+	*tfpp = tfp;
+	tfpp = &tfp->tf_next;
 
-	fp = fopen(fexpand(tagfiles[count], FALSE), "r");
-	if (fp == NULL) {
+#ifdef	MMAP_TAGS
+	if (MapTagFile(fp, fname, tfp)) {
+	    (void) fclose(fp);
 	    continue;
 	}
+#endif
 
-	if (hashtable == NULL) {
-	    /*
-	     * Using calloc() avoids having to clear memory.
-	     */
-	    hashtable = clr_alloc(hashtabsize, sizeof(TAG *));
-	    if (hashtable == NULL) {
-		return;
-	    }
+	if (tc->tc_table == NULL && !GrowHashTable(tc)) {
+	    (void) fclose(fp);
+	    return;
 	}
 
 	while (TRUE) {
@@ -92,12 +508,52 @@ tagInit()
 	    /*
 	     * Enter the tag into the hash table.
 	     */
-	    EnterTag(inbuf);
+	    EnterTag(tc, inbuf);
 	}
 	(void) fclose(fp);
     }
 }
 
+/*
+ * Free all memory used by a tag cache and unmap its tags files.
+ */
+static void
+FreeTagCache(tc)
+TAGCACHE	*tc;
+{
+    TAGFILE	*tfp;
+    TAGARENA	*ap;
+    int		count;
+
+    if (tc == NULL) {
+	return;
+    }
+
+    while ((tfp = tc->tc_files) != NULL) {
+	tc->tc_files = tfp->tf_next;
+#ifdef	MMAP_TAGS
+	FreeTagFile(tfp);
+#endif
+	free(tfp);
+    }
+
+    while ((ap = tc->tc_arena) != NULL) {
+	tc->tc_arena = ap->ta_next;
+	free(ap);
+    }
+
+    if (tc->tc_table != NULL) {
+	free(tc->tc_table);
+    }
+
+    for (count = 0; tc->tc_names[count] != NULL; count++) {
+	free(tc->tc_names[count]);
+    }
+    free(tc->tc_names);
+    free(tc);
+}
+
+
 /*
  * Tag to the word under the cursor.
  */
@@ -196,7 +652,8 @@ bool_t	split;			/* true if want to split */
     tp = tagLookup(tag, &l1, &l2);
     if (tp == NULL) {
 	if (interactive) {
-	    show_error(hashtable==NULL	? "No tags file"
+	    show_error(tagcache == NULL || tagcache->tc_files == NULL
+						? "No tags file"
 						: "Tag not found");
 	}
 	return(FALSE);
@@ -318,21 +775,16 @@ bool_t	split;			/* true if want to split */
     return(edited);
 }
 
+/*
+ * Split a line from a tags file into the fields of a TAG.
+ * The line is modified.
+ */
 static void
-EnterTag(line)
-char	*line;
+ParseTag(line, tp, max_chars)
+char		*line;
+register TAG	*tp;
+register int	max_chars;
 {
-    register TAG	*tp;
-    register TAG	**tpp;
-    register char	*cp;
-    register unsigned	f;
-    register int	max_chars;
-
-    max_chars = Pn(P_taglength);
-    if (max_chars == 0) {
-	max_chars = INT_MAX;
-    }
-
     /*
      * Exuberant ctags creates tags with extra stuff on the end after ;" like
 ANY	regexp.c	95;"	d	file:
@@ -346,17 +798,7 @@ Ev_resize	virtscr.h	/^	Ev_resize,$/;"	e	enum:xvevent::__anon25
 	    && q == p+1 && q[1] == '\t') *p = '\0';
     }
 
-    /*
-     * Allocate space for the structure immediately followed by
-     * the text. Then copy the string into the allocated space
-     * and set up the pointers within the structure.
-     */
-    tp = alloc(sizeof(TAG) + strlen(line) + 1);
-    if (tp == NULL) {
-	return;
-    }
-    tp->t_name = (char *) (tp + 1);
-    (void) strcpy(tp->t_name, line);
+    tp->t_name = line;
     tp->t_file = strchr(tp->t_name, '\t');
     if (tp->t_file == NULL) {
 	tp->t_file = "No File!";
@@ -377,21 +819,667 @@ Ev_resize	virtscr.h	/^	Ev_resize,$/;"	e	enum:xvevent::__anon25
     } else {
 	*(tp->t_locator++) = '\0';
     }
+}
+
+/*
+ * Turn a line from a tags file into a TAG, allocating space for the
+ * structure immediately followed by the text.
+ */
+static TAG *
+MakeTag(line, max_chars)
+char	*line;
+int	max_chars;
+{
+    register TAG	*tp;
+
+    tp = alloc(sizeof(TAG) + strlen(line) + 1);
+    if (tp == NULL) {
+	return(NULL);
+    }
+    ParseTag(strcpy((char *) (tp + 1), line), tp, max_chars);
+    return(tp);
+}
+
+/*
+ * Allocate space for some text in the tag arena.
+ */
+static char *
+ArenaAlloc(tc, size)
+TAGCACHE	*tc;
+size_t		size;
+{
+    register TAGARENA	*ap;
+
+    ap = tc->tc_arena;
+    if (ap == NULL || ap->ta_size - ap->ta_used < size) {
+	size_t	blksize;
+
+	blksize = (size > ARENA_BLOCK) ? size : ARENA_BLOCK;
+	ap = malloc(sizeof(TAGARENA) + blksize);
+	if (ap == NULL) {
+	    return(NULL);
+	}
+	ap->ta_used = 0;
+	ap->ta_size = blksize;
+	ap->ta_next = tc->tc_arena;
+	tc->tc_arena = ap;
+    }
+    ap->ta_used += size;
+    return(ap->ta_text + ap->ta_used - size);
+}
+
+/*
+ * Create the hash table, or double its size and rehash its contents.
+ */
+static bool_t
+GrowHashTable(tc)
+TAGCACHE	*tc;
+{
+    TAGSLOT		*oldtable, *newtable;
+    unsigned long	oldsize, newsize;
+    unsigned long	n;
+    register unsigned long	i;
+
+    oldtable = tc->tc_table;
+    oldsize = tc->tc_tabsize;
+    newsize = (oldsize == 0) ? HASH_MINSIZE : oldsize * 2;
+
+    /*
+     * Using calloc() avoids having to clear memory.
+     */
+    newtable = calloc((size_t) newsize, sizeof(TAGSLOT));
+    if (newtable == NULL) {
+	return(FALSE);
+    }
+    for (n = 0; n < oldsize; n++) {
+	if (oldtable[n].ts_tag.t_name != NULL) {
+	    for (i = oldtable[n].ts_hash & (newsize - 1);
+		 newtable[i].ts_tag.t_name != NULL;
+		 i = (i + 1) & (newsize - 1)) {
+		;
+	    }
+	    newtable[i] = oldtable[n];
+	}
+    }
+    if (oldtable != NULL) {
+	free(oldtable);
+    }
+    tc->tc_table = newtable;
+    tc->tc_tabsize = newsize;
+    return(TRUE);
+}
+
+/*
+ * Enter a line from a tags file into the hash table. If the tag is
+ * already there, the first definition wins, as for mapped files.
+ */
+static void
+EnterTag(tc, line)
+TAGCACHE	*tc;
+char		*line;
+{
+    TAG			tag;
+    TAGSLOT		*table;
+    unsigned long	mask;
+    register char	*cp;
+    register unsigned long	f;
+    register unsigned long	i;
+
+    if (4 * (tc->tc_tabcount + 1) > 3 * tc->tc_tabsize && !GrowHashTable(tc)) {
+	return;
+    }
+
+    cp = ArenaAlloc(tc, strlen(line) + 1);
+    if (cp == NULL) {
+	return;
+    }
+    ParseTag(strcpy(cp, line), &tag, tc->tc_maxchars);
 
     /*
      * Calculate hash value.
      */
-    f = 0;
-    for (cp = tp->t_name; *cp != '\0'; cp++) {
-	f <<= 1;
-	f ^= *cp;
+    f = HASH_INIT;
+    for (cp = tag.t_name; *cp != '\0'; cp++) {
+	f = HASH_STEP(f, *cp);
+    }
+
+    table = tc->tc_table;
+    mask = tc->tc_tabsize - 1;
+    for (i = f & mask; table[i].ts_tag.t_name != NULL; i = (i + 1) & mask) {
+	if (table[i].ts_hash == f &&
+			strcmp(table[i].ts_tag.t_name, tag.t_name) == 0) {
+	    return;
+	}
+    }
+    table[i].ts_hash = f;
+    table[i].ts_tag = tag;
+    tc->tc_tabcount++;
+}
+
+#ifdef	MMAP_TAGS
+/*
+ * Map a tags file into memory. If its header says that it is sorted
+ * in plain byte order (as written by ctags with "!_TAG_FILE_SORTED 1")
+ * it can be searched as it is; otherwise we need an index for it.
+ * Returns FALSE if the file should be read into the hash table instead.
+ */
+static bool_t
+MapTagFile(fp, fname, tfp)
+FILE	*fp;
+char	*fname;
+TAGFILE	*tfp;
+{
+    struct stat	st;
+    char	*map;
+    char	*cp, *end;
+    bool_t	sorted = FALSE;
+    static char	sortedhdr[] = "!_TAG_FILE_SORTED\t";
+
+    if (fstat(fileno(fp), &st) != 0 || st.st_size <= 0 ||
+				(off_t) (size_t) st.st_size != st.st_size) {
+	return(FALSE);
+    }
+    map = mmap((void *) NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED,
+							fileno(fp), (off_t) 0);
+    if (map == (char *) MAP_FAILED) {
+	return(FALSE);
+    }
+    end = map + st.st_size;
+
+    /*
+     * The pseudo-tags at the start of the file all begin with "!_TAG_".
+     */
+    for (cp = map; end - cp > 6 && strncmp(cp, "!_TAG_", 6) == 0; ) {
+	if (end - cp > (int) sizeof(sortedhdr) &&
+		strncmp(cp, sortedhdr, sizeof(sortedhdr) - 1) == 0) {
+	    sorted = (cp[sizeof(sortedhdr) - 1] == '1');
+	    break;
+	}
+	cp = memchr(cp, '\n', end - cp);
+	if (cp == NULL) {
+	    break;
+	}
+	cp++;
+    }
+
+    tfp->tf_map = map;
+    tfp->tf_size = (size_t) st.st_size;
+
+    if (!sorted && !LoadTagIndex(tfp, fname, &st)) {
+	if (!BuildTagIndex(tfp)) {
+	    FreeTagFile(tfp);
+	    return(FALSE);
+	}
+	SaveTagIndex(tfp, fname, &st);
+    }
+    return(TRUE);
+}
+
+/*
+ * Append a string to the name being built in buf, which holds size
+ * bytes; if it doesn't fit, return FALSE. If "flatten" is set, slashes
+ * are replaced so that a whole path becomes one file name.
+ */
+static bool_t
+AddName(buf, size, str, flatten)
+char	*buf;
+size_t	size;
+char	*str;
+bool_t	flatten;
+{
+    register char	*cp;
+
+    for (cp = buf + strlen(buf); *str != '\0'; str++) {
+	if (cp >= buf + size - 1) {
+	    return(FALSE);
+	}
+	*cp++ = (flatten && *str == '/') ? '%' : *str;
+    }
+    *cp = '\0';
+    return(TRUE);
+}
+
+/*
+ * Construct the name of the index file for the given tags file,
+ * either beside it or, if "incache" is set, in the cache directory,
+ * where the path of the tags file is flattened into one name.
+ * The name is put in buf, which holds IDX_NAMESIZE bytes.
+ */
+static bool_t
+IndexName(buf, fname, incache)
+char	*buf;
+char	*fname;
+bool_t	incache;
+{
+    char	*base;
+    char	*home;
+    char	cwd[MAXPATHLEN + 1];
+
+    buf[0] = '\0';
+    if (!incache) {
+	base = strrchr(fname, '/');
+	base = (base == NULL) ? fname : base + 1;
+	if ((size_t) (base - fname) >= IDX_NAMESIZE) {
+	    return(FALSE);
+	}
+	(void) memcpy(buf, fname, (size_t) (base - fname));
+	buf[base - fname] = '\0';
+	return(AddName(buf, IDX_NAMESIZE, IDX_PREFIX, FALSE) &&
+	       AddName(buf, IDX_NAMESIZE, base, FALSE) &&
+	       AddName(buf, IDX_NAMESIZE, IDX_SUFFIX, FALSE));
+    }
+
+    home = getenv("HOME");
+    if (home == NULL) {
+	return(FALSE);
+    }
+    if (fname[0] != '/') {
+	if (getcwd(cwd, sizeof(cwd)) == NULL) {
+	    return(FALSE);
+	}
+	if (!AddName(cwd, sizeof(cwd), "/", FALSE)) {
+	    return(FALSE);
+	}
+    } else {
+	cwd[0] = '\0';
+    }
+    return(AddName(buf, IDX_NAMESIZE, home, FALSE) &&
+	   AddName(buf, IDX_NAMESIZE, "/", FALSE) &&
+	   AddName(buf, IDX_NAMESIZE, IDX_CACHEDIR, FALSE) &&
+	   AddName(buf, IDX_NAMESIZE, "/xvi/", FALSE) &&
+	   AddName(buf, IDX_NAMESIZE, cwd, TRUE) &&
+	   AddName(buf, IDX_NAMESIZE, fname, TRUE));
+}
+
+/*
+ * Try to map an up-to-date index for the given tags file.
+ */
+static bool_t
+LoadTagIndex(tfp, fname, stp)
+TAGFILE		*tfp;
+char		*fname;
+struct stat	*stp;
+{
+    char	name[IDX_NAMESIZE];
+    int		fd;
+    struct stat	ist;
+    char	*imap;
+    TAGIDXHDR	*hp;
+    bool_t	incache;
+
+    for (incache = FALSE; incache <= TRUE; incache++) {
+	if (!IndexName(name, fname, incache)) {
+	    continue;
+	}
+	fd = open(name, O_RDONLY);
+	if (fd < 0) {
+	    continue;
+	}
+	if (fstat(fd, &ist) != 0 || ist.st_size < (off_t) sizeof(TAGIDXHDR)) {
+	    (void) close(fd);
+	    continue;
+	}
+	imap = mmap((void *) NULL, (size_t) ist.st_size, PROT_READ,
+					    MAP_SHARED, fd, (off_t) 0);
+	(void) close(fd);
+	if (imap == (char *) MAP_FAILED) {
+	    continue;
+	}
+
+	/*
+	 * Only trust the index if it was made from the same tags file,
+	 * of the same size and age, it has exactly the size it says it
+	 * has, and every offset in it is the start of a line.
+	 */
+	hp = (TAGIDXHDR *) imap;
+	if (strncmp(hp->ti_magic, IDX_MAGIC, sizeof(hp->ti_magic)) != 0 ||
+	    hp->ti_dev != (unsigned long) stp->st_dev ||
+	    hp->ti_ino != (unsigned long) stp->st_ino ||
+	    hp->ti_size != (unsigned long) stp->st_size ||
+	    hp->ti_mtime != (unsigned long) stp->st_mtime ||
+	    hp->ti_mnsec != ST_MNSEC(stp) ||
+	    hp->ti_count > tfp->tf_size ||
+	    (unsigned long) ist.st_size != sizeof(TAGIDXHDR) +
+				hp->ti_count * sizeof(unsigned long) ||
+	    !CheckTagIndex(tfp, (unsigned long *) (hp + 1), hp->ti_count)) {
+	    (void) munmap((void *) imap, (size_t) ist.st_size);
+	    continue;
+	}
+
+	tfp->tf_imap = imap;
+	tfp->tf_isize = (size_t) ist.st_size;
+	tfp->tf_index = (unsigned long *) (hp + 1);
+	tfp->tf_count = hp->ti_count;
+	return(TRUE);
     }
+    return(FALSE);
+}
 
-    tpp = &hashtable[f % hashtabsize];
-    tp->t_next = *tpp;
-    *tpp = tp;
+/*
+ * Check that each of the given offsets is the start of
+ * a line in the mapped tags file.
+ */
+static bool_t
+CheckTagIndex(tfp, index, count)
+TAGFILE		*tfp;
+unsigned long	*index;
+unsigned long	count;
+{
+    char			*map = tfp->tf_map;
+    register unsigned long	i;
+
+    for (i = 0; i < count; i++) {
+	if (index[i] >= tfp->tf_size ||
+			(index[i] != 0 && map[index[i] - 1] != '\n')) {
+	    return(FALSE);
+	}
+    }
+    return(TRUE);
 }
 
+/*
+ * Used by qsort() when building an index: the tags file being indexed.
+ */
+static	char	*sortmap;
+static	char	*sortend;
+
+/*
+ * Order two lines of a tags file by tag name, then by their position
+ * in the file so that the first of any duplicates is found first.
+ */
+static int
+idxcmp(p1, p2)
+const genptr	*p1;
+const genptr	*p2;
+{
+    unsigned long		o1 = *(const unsigned long *) p1;
+    unsigned long		o2 = *(const unsigned long *) p2;
+    register unsigned char	*s1 = (unsigned char *) sortmap + o1;
+    register unsigned char	*s2 = (unsigned char *) sortmap + o2;
+    register unsigned char	*end = (unsigned char *) sortend;
+    register int		c1, c2;
+
+    for (;;) {
+	c1 = (s1 >= end || *s1 == '\t' || *s1 == '\n') ? -1 : *s1++;
+	c2 = (s2 >= end || *s2 == '\t' || *s2 == '\n') ? -1 : *s2++;
+	if (c1 != c2) {
+	    return(c1 - c2);
+	}
+	if (c1 < 0) {
+	    return(o1 < o2 ? -1 : o1 > o2 ? 1 : 0);
+	}
+    }
+}
+
+/*
+ * Build an index of the lines in a mapped tags file, sorted by tag name.
+ */
+static bool_t
+BuildTagIndex(tfp)
+TAGFILE	*tfp;
+{
+    char		*map = tfp->tf_map;
+    char		*end = map + tfp->tf_size;
+    register char	*cp;
+    unsigned long	count;
+    unsigned long	*index;
+
+    count = 0;
+    for (cp = map; cp < end; cp++) {
+	if (*cp == '\n') {
+	    count++;
+	}
+    }
+    if (end[-1] != '\n') {
+	count++;
+    }
+
+    index = malloc((size_t) count * sizeof(unsigned long) + 1);
+    if (index == NULL) {
+	return(FALSE);
+    }
+
+    count = 0;
+    for (cp = map; cp < end; ) {
+	if (*cp != '\n') {
+	    index[count++] = cp - map;
+	}
+	cp = memchr(cp, '\n', end - cp);
+	if (cp == NULL) {
+	    break;
+	}
+	cp++;
+    }
+
+    sortmap = map;
+    sortend = end;
+    qsort((genptr *) index, (size_t) count, sizeof(unsigned long), idxcmp);
+
+    tfp->tf_index = index;
+    tfp->tf_count = count;
+    return(TRUE);
+}
+
+/*
+ * Write out the index we have just built, so that it can be reused by
+ * other invocations of the editor. The index file is written under a
+ * temporary name first so that nobody else ever sees a partial one.
+ * Failure is not an error; the index will just be built again next time.
+ */
+static void
+SaveTagIndex(tfp, fname, stp)
+TAGFILE		*tfp;
+char		*fname;
+struct stat	*stp;
+{
+    char	name[IDX_NAMESIZE];
+    char	tmpname[IDX_NAMESIZE + 24];
+    FILE	*fp;
+    TAGIDXHDR	hdr;
+    bool_t	incache;
+    bool_t	written;
+
+    (void) memcpy(hdr.ti_magic, IDX_MAGIC, sizeof(hdr.ti_magic));
+    hdr.ti_dev = (unsigned long) stp->st_dev;
+    hdr.ti_ino = (unsigned long) stp->st_ino;
+    hdr.ti_size = (unsigned long) stp->st_size;
+    hdr.ti_mtime = (unsigned long) stp->st_mtime;
+    hdr.ti_mnsec = ST_MNSEC(stp);
+    hdr.ti_count = tfp->tf_count;
+
+    for (incache = FALSE; incache <= TRUE; incache++) {
+	if (!IndexName(name, fname, incache)) {
+	    continue;
+	}
+	if (incache) {
+	    char	dir[IDX_NAMESIZE];
+
+	    /*
+	     * Make sure that the cache directory exists.
+	     */
+	    dir[0] = '\0';
+	    if (AddName(dir, sizeof(dir), getenv("HOME"), FALSE) &&
+		AddName(dir, sizeof(dir), "/", FALSE) &&
+		AddName(dir, sizeof(dir), IDX_CACHEDIR, FALSE)) {
+		(void) mkdir(dir, 0700);
+		if (AddName(dir, sizeof(dir), "/xvi", FALSE)) {
+		    (void) mkdir(dir, 0700);
+		}
+	    }
+	}
+
+	(void) sprintf(tmpname, "%s.%ld", name, (long) getpid());
+	fp = fopenwb(tmpname);
+	if (fp == NULL) {
+	    continue;
+	}
+	written = fwrite((char *) &hdr, sizeof(hdr), 1, fp) == 1 &&
+		  fwrite((char *) tfp->tf_index, sizeof(unsigned long),
+			 (size_t) tfp->tf_count, fp) == tfp->tf_count;
+	if (fclose(fp) == 0 && written && rename(tmpname, name) == 0) {
+	    break;
+	}
+	(void) remove(tmpname);
+    }
+}
+
+/*
+ * Release the memory and mappings used by a tags file.
+ */
+static void
+FreeTagFile(tfp)
+TAGFILE	*tfp;
+{
+    if (tfp->tf_imap != NULL) {
+	(void) munmap((void *) tfp->tf_imap, tfp->tf_isize);
+    } else if (tfp->tf_index != NULL) {
+	free(tfp->tf_index);
+    }
+    if (tfp->tf_map != NULL) {
+	(void) munmap((void *) tfp->tf_map, tfp->tf_size);
+    }
+    tfp->tf_imap = NULL;
+    tfp->tf_index = NULL;
+    tfp->tf_map = NULL;
+}
+
+/*
+ * Compare the tag name at the start of a line in a mapped tags file
+ * with the first "length" characters of "name", in the byte order used
+ * by sort(1) in the C locale. Returns 0 if the tag name starts with
+ * those characters, and sets *namelenp to the length of the tag name.
+ */
+static int
+tagcmp(line, end, name, length, namelenp)
+char	*line;
+char	*end;
+char	*name;
+int	length;
+int	*namelenp;
+{
+    register unsigned char	*lp = (unsigned char *) line;
+    register unsigned char	*np = (unsigned char *) name;
+    register int		n;
+
+    for (n = 0; n < length; n++, lp++, np++) {
+	if ((char *) lp >= end || *lp == '\t' || *lp == '\n') {
+	    return(-1);
+	}
+	if (*lp != *np) {
+	    return((int) *lp - (int) *np);
+	}
+    }
+    while ((char *) lp < end && *lp != '\t' && *lp != '\n') {
+	lp++;
+	n++;
+    }
+    *namelenp = n;
+    return(0);
+}
+
+/*
+ * Binary-search a mapped tags file for the tag whose name is the first
+ * "length" characters of "name". The lines beginning with those
+ * characters are contiguous, and an exact match sorts first among them
+ * because a tab is less than any identifier character.
+ */
+static TAG *
+SearchTagFile(tfp, name, length, max_chars)
+TAGFILE	*tfp;
+char	*name;
+int	length;
+int	max_chars;
+{
+    char	*map = tfp->tf_map;
+    char	*end = map + tfp->tf_size;
+    size_t	lo, hi, mid;
+    int		namelen;
+    char	*nl;
+
+    if (tfp->tf_index != NULL) {
+	unsigned long	*index = tfp->tf_index;
+
+	lo = 0;
+	hi = tfp->tf_count;
+	while (lo < hi) {
+	    mid = lo + (hi - lo) / 2;
+	    ts_bprobes++;
+	    if (tagcmp(map + index[mid], end, name, length, &namelen) < 0) {
+		lo = mid + 1;
+	    } else {
+		hi = mid;
+	    }
+	}
+	if (lo >= tfp->tf_count ||
+	    tagcmp(map + index[lo], end, name, length, &namelen) != 0 ||
+	    (namelen != length && length < max_chars)) {
+	    return(NULL);
+	}
+	return(MappedTag(tfp, index[lo], max_chars));
+    }
+
+    /*
+     * Invariant: lo is the start of a line, every line starting
+     * before lo sorts before the name, and no line starting at or
+     * after hi does.
+     */
+    lo = 0;
+    hi = tfp->tf_size;
+    while (lo < hi) {
+	mid = lo + (hi - lo) / 2;
+	while (mid > lo && map[mid - 1] != '\n') {
+	    mid--;
+	}
+	ts_bprobes++;
+	if (tagcmp(map + mid, end, name, length, &namelen) < 0) {
+	    nl = memchr(map + mid, '\n', tfp->tf_size - mid);
+	    lo = (nl == NULL) ? tfp->tf_size : (size_t) (nl - map) + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+
+    if (lo >= tfp->tf_size ||
+	tagcmp(map + lo, end, name, length, &namelen) != 0 ||
+	(namelen != length && length < max_chars)) {
+	return(NULL);
+    }
+    return(MappedTag(tfp, (unsigned long) lo, max_chars));
+}
+
+/*
+ * Make a TAG from a private copy of the line found at the given offset
+ * in a mapped tags file.
+ */
+static TAG *
+MappedTag(tfp, offset, max_chars)
+TAGFILE		*tfp;
+unsigned long	offset;
+int		max_chars;
+{
+    char	*start = tfp->tf_map + offset;
+    char	*nl;
+    char	*line;
+    size_t	len;
+
+    nl = memchr(start, '\n', tfp->tf_size - offset);
+    len = (nl == NULL ? tfp->tf_map + tfp->tf_size : nl) - start;
+    line = alloc(len + 1);
+    if (line == NULL) {
+	return(NULL);
+    }
+    (void) memcpy(line, start, len);
+    line[len] = '\0';
+
+    if (mappedtag != NULL) {
+	free(mappedtag);
+    }
+    mappedtag = MakeTag(line, max_chars);
+    free(line);
+    return(mappedtag);
+}
+#endif	/* MMAP_TAGS */
+
 /*
  * Look up the given name to see if it is a valid tag. The string
  * might not be null-terminated, so we only look at characters which
@@ -410,9 +1498,16 @@ int	*offsetptr;
 {
     register TAG	*tp;
     register char	*cp;
-    register unsigned	f;
+    register unsigned long	f;
     register int	length, offset;
     int			max_chars;
+    TAGCACHE		*tc;
+    TAGFILE		*tfp;
+    TAGSLOT		*table;
+    unsigned long	mask;
+    bool_t		hashed;
+    unsigned long	i;
+    unsigned long	nprobes;
 
     if (name[0] == '\0') {
 	*offsetptr = 0;
@@ -420,13 +1515,11 @@ int	*offsetptr;
     }
 
     /*
-     * Check that the tag cache is loaded; if not, load it now.
+     * Wait for the tag cache if it is still being loaded.
      */
-    if (hashtable == NULL) {
-	tagInit();
-	if (hashtable == NULL) {
-	    return(NULL);
-	}
+    tc = CurrentTags();
+    if (tc == NULL || tc->tc_files == NULL) {
+	return(NULL);
     }
 
     if (!IDCHAR(*name)) {
@@ -442,21 +1535,16 @@ int	*offsetptr;
 	return(NULL);
     }
 
-    max_chars = Pn(P_taglength);
-    if (max_chars == 0) {
-	max_chars = INT_MAX;
-    }
+    max_chars = tc->tc_maxchars;
 
     /*
      * Calculate hash value.
      */
-    f = 0;
+    f = HASH_INIT;
     for (cp = name, length = 0;
 			*cp != '\0' && IDCHAR(*cp) && length < max_chars;
 			cp++, length++) {
-	
-	f <<= 1;
-	f ^= *cp;
+	f = HASH_STEP(f, *cp);
     }
     *lenptr = length;
 
@@ -468,48 +1556,137 @@ int	*offsetptr;
     }
     *offsetptr = offset;
 
-    for (tp = hashtable[f % hashtabsize]; tp != NULL; tp = tp->t_next) {
-	/*
-	 * Match if strings are identical up to the tag length, AND
-	 * the stored tag string is not longer than that length.
-	 */
-	if (strncmp(name, tp->t_name, length) == 0 &&
-					strlen(tp->t_name) <= length) {
-	    return(tp);
+    ts_lookups++;
+
+    /*
+     * Search the tags files in order. All the unsorted ones share
+     * the hash table, so it only needs searching once.
+     */
+    hashed = FALSE;
+    table = tc->tc_table;
+    mask = tc->tc_tabsize - 1;
+    for (tfp = tc->tc_files; tfp != NULL; tfp = tfp->tf_next) {
+#ifdef	MMAP_TAGS
+	if (tfp->tf_map != NULL) {
+	    tp = SearchTagFile(tfp, name, length, max_chars);
+	    if (tp != NULL) {
+		ts_hits++;
+		return(tp);
+	    }
+	    continue;
+	}
+#endif
+	if (hashed || table == NULL) {
+	    continue;
+	}
+	hashed = TRUE;
+
+	ts_hsearches++;
+	nprobes = 0;
+	for (i = f & mask; table[i].ts_tag.t_name != NULL; i = (i + 1) & mask) {
+	    nprobes++;
+	    tp = &table[i].ts_tag;
+	    /*
+	     * Match if strings are identical up to the tag length, AND
+	     * the stored tag string is not longer than that length.
+	     */
+	    if (table[i].ts_hash == f &&
+		strncmp(name, tp->t_name, length) == 0 &&
+		tp->t_name[length] == '\0') {
+		break;
+	    }
+	}
+	ts_hprobes += nprobes;
+	if (nprobes > ts_hmaxprobe) {
+	    ts_hmaxprobe = nprobes;
+	}
+	if (table[i].ts_tag.t_name != NULL) {
+	    ts_hits++;
+	    return(&table[i].ts_tag);
 	}
     }
     return(NULL);
 }
 
 /*
- * Free all memory used by the tag cache, and set hashtable to NULL.
- * This causes a complete reload next time a tag lookup is performed.
+ * Produce the lines shown by the ":tagstats" command, one per call.
  */
-static void
-tagFree()
+static	int	statline;
+
+static char *
+tagStatLine()
 {
-    int		count;
+    static Flexbuf	line;
+    TAGFILE		*tfp;
+    TAGARENA		*ap;
+    int			nmapped, nhashed;
+    unsigned long	textsize;
 
-    if (hashtable == NULL) {
-	return;
+    flexclear(&line);
+    if (tagcache == NULL) {
+	if (statline++ != 0) {
+	    return(NULL);
+	}
+	(void) lformat(&line, "Tags files:     not loaded");
+	return(flexgetstr(&line));
     }
-
-    for (count = 0; count < hashtabsize; count++) {
-	TAG	*tp, *tmp;
-
-	for (tp = hashtable[count]; tp != NULL; ) {
-	    tmp = tp;
-	    tp = tp->t_next;
-	    free(tmp);
+    switch (statline++) {
+    case 0:
+	nmapped = nhashed = 0;
+	for (tfp = tagcache->tc_files; tfp != NULL; tfp = tfp->tf_next) {
+	    if (tfp->tf_map != NULL) {
+		nmapped++;
+	    } else {
+		nhashed++;
+	    }
+	}
+	(void) lformat(&line, "Tags files:     %d mapped, %d hashed",
+							nmapped, nhashed);
+	break;
+    case 1:
+	textsize = 0;
+	for (ap = tagcache->tc_arena; ap != NULL; ap = ap->ta_next) {
+	    textsize += ap->ta_used;
 	}
+	(void) lformat(&line, "Hash table:     %lu of %lu slots used, %lu bytes of text",
+			tagcache->tc_tabcount, tagcache->tc_tabsize, textsize);
+	break;
+    case 2:
+	(void) lformat(&line, "Lookups:        %lu, of which %lu found, %lu waited for loading",
+						ts_lookups, ts_hits, ts_waits);
+	break;
+    case 3:
+	(void) lformat(&line, "Hash probes:    %lu.%02lu on average, %lu at most",
+		ts_hsearches == 0 ? 0 : ts_hprobes / ts_hsearches,
+		ts_hsearches == 0 ? 0 : ts_hprobes * 100 / ts_hsearches % 100,
+		ts_hmaxprobe);
+	break;
+    case 4:
+	(void) lformat(&line, "Binary search:  %lu lines examined", ts_bprobes);
+	break;
+    default:
+	return(NULL);
     }
-    free(hashtable);
-    hashtable = NULL;
+    return(flexgetstr(&line));
+}
+
+/*
+ * Show how well the tag cache is doing, for the ":tagstats" command.
+ */
+void
+tagStats()
+{
+#ifdef	TAG_THREADS
+    JoinTagLoader();
+#endif
+    statline = 0;
+    disp_init(tagStatLine, (int) curwin->w_ncols, FALSE);
 }
 
 /*
- * If someone sets a tags-related parameter, we just invalidate the
- * entire tag cache, causing an automatic reload at next reference.
+ * If someone sets a tags-related parameter, we just mark the tag cache
+ * as stale; a new one is started after the value has been set, or at
+ * the next reference, whichever comes first.
  */
 /*ARGSUSED*/
 bool_t
@@ -517,6 +1694,6 @@ tagSetParam(new_value, interactive)
 Paramval	new_value;
 bool_t		interactive;
 {
-    tagFree();
+    tagsstale = TRUE;
     return(TRUE);
 }
@@ -71,12 +71,21 @@ static	void		xygoto P((VirtScr *, int, int));
 static	void		put_str P((VirtScr *, int, int, char *));
 static	void		put_char P((VirtScr *, int, int, int));
 static	void		ins_str P((VirtScr *, int, int, char *));
+static	void		del_chars P((VirtScr *, int, int, int));
+static	int		insdel_cost P((VirtScr *, int));
 static	void		pset_colour P((VirtScr *, int));
 static	int		scroll P((VirtScr *, int, int, int));
 static	int		can_scroll P((VirtScr *, int, int, int));
+static	int		scroll_cost P((int, int, int));
+static	int		tccost P((char *, int));
 static	void		flushout P((VirtScr *));
 static	void		pbeep P((VirtScr *));
 static	void		do_auto_margin_motion P((void));
+static	char		*outstats P((VirtScr *, int));
+static	void		outcap P((char *, int, int));
+static	void		oc_charge P((int));
+static	int		getkey P((long));
+static	bool_t		get_paste P((void));
 
 VirtScr	tcap_scr = {
     NULL,		/* pv_sys_ptr       */
@@ -102,6 +111,9 @@ VirtScr	tcap_scr = {
     ins_str,		/* v_insert	    */
     scroll,		/* v_scroll	    */
     can_scroll,		/* v_can_scroll     */
+    del_chars,		/* v_delete	    */
+    insdel_cost,	/* v_insdel_cost    */
+    outstats,		/* v_stats	    */
 };
 
 static	void	xyupdate P((void));
@@ -161,6 +173,7 @@ static	char	*TI, *TE;		/* cursor motion start/end */
 static	char	*CE, *CL;		/* erase line/display */
 static	char	*AL, *DL;		/* insert/delete line */
 static	char	*IC, *IM, *EI;		/* insert character / insert mode */
+static	char	*DC, *DM, *ED;		/* delete character / delete mode */
 static	char	*CM;			/* cursor motion string */
 static	char	*HO;			/* cursor to home position */
 static	char	*CS;			/* change scroll region */
@@ -170,6 +183,9 @@ static	char	*MR, *MD, *ME;		/* reverse/double-intensity mode start/end */
 
 static	char	*VB;			/* visual bell */
 
+static	char	*BE, *BD;		/* bracketed paste enable/disable */
+static	char	*PS, *PE;		/* start/end of pasted text */
+
 static	char	*colours[10];		/* colour caps c0 .. c9 */
 static	int	ncolours;		/* number of colour caps we have */
 
@@ -188,6 +204,7 @@ static	bool_t	newline_glitch;		/* "xn" capability */
 #define	can_movedown	(down != NULL)	/* true if can move down (do) */
 #define	can_moveup	(up != NULL)	/* true if can move up (up) */
 #define can_inschar	(IC != NULL || IM != NULL)
+#define can_delchar	(DC != NULL)	/* true if we can delete chars */
 #define can_del_line	(DL != NULL)	/* true if we can delete lines */
 #define can_ins_line	(AL != NULL)	/* true if we can insert lines */
 #define can_clr_to_eol	(CE != NULL)	/* true if can clr-to-eol */
@@ -256,6 +273,23 @@ static struct {
  */
 static int	s_top = 0, s_bottom = 0;
 
+/*
+ * Bracketed paste. If the terminal can send PS before pasted text
+ * and PE after it, we collect everything in between into pastebuf
+ * and give it to the editor as a single Ev_paste event. Characters
+ * read while looking for a PS which turned out not to be one are
+ * kept in held[] and returned by getkey() before any more input.
+ */
+static	Flexbuf		pastebuf;
+static	unsigned char	held[16];
+static	int		nheld = 0;	/* number of characters in held[] */
+static	int		heldp = 0;	/* next one to return */
+
+/*
+ * Input characters that arrive together are passed on in this.
+ */
+static	char		inbuf[4096];
+
 /*
  * Used for colour-setting optimisation.
  */
@@ -263,6 +297,37 @@ static int	s_top = 0, s_bottom = 0;
 static	int	old_colour = NO_COLOUR;	/* Screen's current drawing colour */
 static	int	new_colour = NO_COLOUR;	/* The colour they asked for last */
 
+/*
+ * Output accounting, for the ":outstats" command.
+ *
+ * Every byte we send is charged to the category of the last escape
+ * sequence or run of characters we started (see oc_charge()), so
+ * the byte counts are exact, padding included. We also count the
+ * escape sequences themselves, the calls made to us through the
+ * VirtScr interface, and the number and size of screen updates.
+ */
+#define	OC_MOTION	0
+#define	OC_TEXT		1
+#define	OC_CLEAR	2
+#define	OC_SCROLL	3
+#define	OC_COLOUR	4
+#define	OC_INSDEL	5
+#define	OC_OTHER	6
+#define	NOC		7
+
+static	char		*oc_names[NOC] = {
+    "Cursor motion:", "Text:", "Clear:", "Scroll:",
+    "Colour:", "Insert/delete:", "Other:",
+};
+static	unsigned long	oc_bytes[NOC];		/* bytes sent */
+static	unsigned long	oc_seqs[NOC];		/* escape sequences sent */
+static	unsigned long	oc_calls[NOC];		/* VirtScr calls made */
+static	unsigned long	oc_updates;		/* screen updates flushed */
+static	unsigned long	oc_maxupdate;		/* bytes in the biggest one */
+static	int		oc_cat = OC_OTHER;	/* what we're sending now */
+static	long		oc_mark;		/* obcount() when it started */
+static	long		oc_update;		/* obcount() at last flush */
+
 extern	volatile bool_t	win_size_changed;
 
 /*ARGSUSED*/
@@ -298,6 +363,9 @@ char	*argv[];
     if (!can_inschar) {
 	vs->v_insert = NOFUNC;
     }
+    if (!can_delchar) {
+	vs->v_delete = NOFUNC;
+    }
     vs->pv_rows = LI;
     vs->pv_cols = CO;
 
@@ -336,8 +404,10 @@ char	*argv[];
     while (1) {
 	xvResponse	*resp;
 	register int	r;
+	bool_t		was_held;
 
-	r = inch(timeout);
+	was_held = (heldp < nheld);
+	r = getkey(timeout);
 	if (r == EOF) {
 	    if (kbdintr) {
 		event.ev_type = Ev_breakin;
@@ -370,9 +440,28 @@ char	*argv[];
 	    } else {
 		event.ev_type = Ev_timeout;
 	    }
+	} else if (!was_held && PS != NULL && r == (PS[0] & 0xff) &&
+							get_paste()) {
+	    event.ev_type = Ev_paste;
+	    event.ev_paste = flexgetstr(&pastebuf);
 	} else {
-	    event.ev_type = Ev_char;
-	    event.ev_inchar = r;
+	    int		n;
+
+	    /*
+	     * Pass on any more input that has already arrived
+	     * along with this character, up to a possible paste.
+	     */
+	    n = (heldp < nheld) ? 0 : kbread(inbuf + 1, sizeof(inbuf) - 1,
+				    (PS != NULL) ? (PS[0] & 0xff) : EOF);
+	    if (n == 0) {
+		event.ev_type = Ev_char;
+		event.ev_inchar = r;
+	    } else {
+		inbuf[0] = r;
+		event.ev_type = Ev_chars;
+		event.ev_chars = inbuf;
+		event.ev_nchars = n + 1;
+	    }
 	}
 	resp = xvi_handle_event(&event);
 	if (resp->xvr_type == Xvr_exit) {
@@ -382,6 +471,83 @@ char	*argv[];
     }
 }
 
+/*
+ * Get the next input character, either one held over from looking
+ * for a paste or a new one from the keyboard.
+ */
+static int
+getkey(timeout)
+long	timeout;
+{
+    if (heldp < nheld) {
+	return(held[heldp++]);
+    }
+    return(inch(timeout));
+}
+
+/*
+ * Called when we have just read the first character of PS.
+ *
+ * If the rest of PS follows it, read everything up to PE into
+ * pastebuf and return TRUE. The terminal sends PS all at once,
+ * so if no more input is waiting this can't be a paste and we
+ * don't wait for any; this keeps a typed ESC working at once.
+ *
+ * Otherwise, return FALSE, leaving anything we read after the
+ * first character in held[].
+ */
+static bool_t
+get_paste()
+{
+    int		c;
+    int		i;
+    int		pelen;
+
+    nheld = heldp = 0;
+    for (i = 1; PS[i] != '\0'; i++) {
+	if (!kbpending() || (c = inch(0L)) == EOF) {
+	    return(FALSE);
+	}
+	held[nheld++] = c;
+	if (c != (PS[i] & 0xff)) {
+	    return(FALSE);
+	}
+    }
+    nheld = 0;
+
+    /*
+     * Now collect the pasted text. We can't put NULs into the
+     * buffer, so they are dropped. If input stops before PE,
+     * because of a signal or disconnection, we finish there and
+     * let the main loop deal with it.
+     */
+    flexclear(&pastebuf);
+    pelen = strlen(PE);
+    while (1) {
+	c = inch(0L);
+	if (c == EOF) {
+	    if (kbdintr || SIG_terminate || SIG_suspend_request ||
+				SIG_user_disconnected || win_size_changed) {
+		break;
+	    }
+	    continue;
+	}
+	if (c == '\0') {
+	    continue;
+	}
+	(void) flexaddch(&pastebuf, c);
+	if (c == (PE[pelen - 1] & 0xff) && flexlen(&pastebuf) >= pelen &&
+		strcmp(flexgetstr(&pastebuf) + flexlen(&pastebuf) - pelen,
+								PE) == 0) {
+	    for (i = 0; i < pelen; i++) {
+		flexrmchar(&pastebuf);
+	    }
+	    break;
+	}
+    }
+    return(TRUE);
+}
+
 /*ARGSUSED*/
 static VirtScr *
 newscr(scr, win)
@@ -403,6 +569,7 @@ static void
 clear_all(scr)
 VirtScr	*scr;
 {
+    oc_calls[OC_CLEAR]++;
     erase_display();
 }
 
@@ -413,6 +580,7 @@ VirtScr	*scr;
 int	row;
 int	col;
 {
+    oc_calls[OC_CLEAR]++;
     if (col < scr->pv_cols) {
 	if (can_clr_to_eol) {
 	    tty_goto(row, col);
@@ -443,6 +611,7 @@ int	col;
 		if (*ext != ' ' || *colour != 0) {
 		    tty_goto(row, col);
 		    xyupdate();
+		    oc_charge(OC_CLEAR);
 		    moutch(' ');
 		    real_col++;
 		    if (real_col == CO)
@@ -466,6 +635,7 @@ VirtScr	*scr;
 int	row;
 int	col;
 {
+    oc_calls[OC_MOTION]++;
     tty_goto(row, col);
 }
 
@@ -477,6 +647,7 @@ int	row;
 int	col;
 char	*str;
 {
+    oc_calls[OC_TEXT]++;
     tty_goto(row, col);
     outstr(str);
 }
@@ -489,6 +660,7 @@ int	row;
 int	col;
 int	c;
 {
+    oc_calls[OC_TEXT]++;
     tty_goto(row, col);
     outchar(c);
 }
@@ -505,12 +677,63 @@ char	*str;
      * If we are called, can_inschar is TRUE,
      * so we know it is safe to use inschar().
      */
+    oc_calls[OC_INSDEL]++;
     tty_goto(row, col);
     for ( ; *str != '\0'; str++) {
 	inschar(*str);
     }
 }
 
+/*ARGSUSED*/
+static void
+del_chars(scr, row, col, nchars)
+VirtScr	*scr;
+int	row;
+int	col;
+int	nchars;
+{
+    /*
+     * If we are called, can_delchar is TRUE.
+     */
+    oc_calls[OC_INSDEL]++;
+    tty_goto(row, col);
+    xyupdate();
+    if (DM != NULL) {
+	outcap(DM, (int) LI, OC_INSDEL);
+    }
+    for ( ; nchars > 0; nchars--) {
+	outcap(DC, (int) LI, OC_INSDEL);
+    }
+    if (ED != NULL) {
+	outcap(ED, (int) LI, OC_INSDEL);
+    }
+}
+
+/*
+ * Return an estimate of the number of bytes needed to insert (if
+ * nchars is positive) or delete (if negative) characters in a line,
+ * including the inserted characters themselves; 0 if we can't.
+ */
+/*ARGSUSED*/
+static int
+insdel_cost(scr, nchars)
+VirtScr	*scr;
+int	nchars;
+{
+    if (nchars > 0) {
+	if (IC != NULL) {
+	    return(nchars * (tccost(IC, (int) LI) + 1));
+	} else if (IM != NULL) {
+	    return(nchars * (tccost(IM, (int) LI) + 1 +
+				tccost(EI, (int) LI)));
+	}
+    } else if (nchars < 0 && can_delchar) {
+	return(tccost(DM, (int) LI) - nchars * tccost(DC, (int) LI) +
+				tccost(ED, (int) LI));
+    }
+    return(0);
+}
+
 /*
  * Set the specified colour. Just does standout/standend mode for now.
  * Optimisation here to avoid setting standend when we aren't in
@@ -524,6 +747,7 @@ pset_colour(scr, colour)
 VirtScr	*scr;
 int	colour;
 {
+    oc_calls[OC_COLOUR]++;
     new_colour = colour;
 }
 
@@ -539,7 +763,7 @@ do_set_colour(int colour)
 	/*
 	 * Within the range of possible colours.
 	 */
-	tputs(colours[colour], 1, foutch);
+	outcap(colours[colour], 1, OC_COLOUR);
     } else {
 	/*
 	 * No colour caps, so use standout/standend.
@@ -563,20 +787,20 @@ do_set_colour(int colour)
 	switch (colour) {
 	case 0:				/* no colour */
 	    if (ME != NULL) {
-		tputs(ME, 1, foutch);
+		outcap(ME, 1, OC_COLOUR);
 	    }
 	    break;
 
 	case 4:				/* double intensity */
 	    if (MD != NULL) {
-		tputs(MD, 1, foutch);
+		outcap(MD, 1, OC_COLOUR);
 		break;
 	    }
 	    /* else FALL THROUGH */
 
 	default:			/* reverse */
 	    if (MR != NULL) {
-		tputs(MR, 1, foutch);
+		outcap(MR, 1, OC_COLOUR);
 	    }
 	}
     }
@@ -590,10 +814,11 @@ do_set_colour(int colour)
  * Negative nlines means scroll reverse - i.e. move the text downwards
  * with respect to the terminal.
  *
- * Return 1 if the scrolling was done or is possible, 0 otherwise.
+ * Return 1 if the scrolling was done, 0 otherwise.
  *
  * If "doit" is FALSE, don't move the screen and just return whether it's
- * possible or not.
+ * possible or not; if it is, the value returned is an estimate of the
+ * number of bytes it would take.
  */
 /*ARGSUSED*/
 static int
@@ -605,8 +830,10 @@ int	nlines;
 bool_t	doit;
 {
     register int	vs_rows;
+    int			count;
 
     vs_rows = scr->pv_rows;
+    count = nlines;
 
     if (nlines < 0) {
 	nlines = -nlines;
@@ -623,7 +850,7 @@ bool_t	doit;
 		    tty_goto(start_row, 0);
 		    xyupdate();
 		    if (AL != NULL) {
-			tputs(AL, vs_rows, foutch);
+			outcap(AL, vs_rows, OC_SCROLL);
 		    }
 		}
 	    }
@@ -652,7 +879,7 @@ bool_t	doit;
 		    tty_goto(end_row, 0);
 		    xyupdate();
 		    for (line = 0; line < nlines; line++) {
-			tputs(down, 1, foutch);
+			outcap(down, 1, OC_SCROLL);
 		    }
 		}
 	    } else if (can_del_line) {
@@ -669,7 +896,58 @@ bool_t	doit;
 	    return(0);
 	}
     }
-    return(1);
+    return(doit ? 1 : scroll_cost(start_row, end_row, count));
+}
+
+/*
+ * Return an estimate of the number of bytes, including padding,
+ * that tcscroll() would send to scroll the given area.
+ */
+static int
+scroll_cost(start_row, end_row, nlines)
+int	start_row;
+int	end_row;
+int	nlines;
+{
+    int		affcnt;
+    int		count;
+    int		motion;
+    int		total;
+    char	*str;
+
+    affcnt = end_row - start_row;
+    count = (nlines < 0) ? -nlines : nlines;
+    motion = (CM != NULL) ? tccost(tgoto(CM, 0, start_row), (int) LI)
+			  : cost_home + cost_down * start_row;
+
+    if (can_scroll_area) {
+	total = motion;
+	total += tccost(tgoto(CS, end_row, start_row), affcnt);
+	total += tccost(tgoto(CS, (int) LI - 1, 0), (int) LI - 1);
+	if (nlines > 0) {
+	    if (SF != NULL && (count > 1 || sf == NULL)) {
+		return(total + tccost(tgoto(SF, count, count), affcnt));
+	    }
+	    str = (sf != NULL) ? sf : (DL != NULL) ? DL : down;
+	} else {
+	    if (SR != NULL && (count > 1 || sr == NULL)) {
+		return(total + tccost(tgoto(SR, count, count), affcnt));
+	    }
+	    str = (sr != NULL) ? sr : AL;
+	}
+    } else if (nlines > 0 && start_row == 0) {
+	total = motion;
+	str = down;
+    } else {
+	/*
+	 * Lines are inserted or deleted one at a time,
+	 * moving the cursor before each one.
+	 */
+	total = count * motion;
+	str = (nlines > 0) ? DL : AL;
+    }
+    total += count * tccost(str, affcnt);
+    return((total > 0) ? total : 1);
 }
 
 /*
@@ -682,12 +960,13 @@ int	start_row;
 int	end_row;
 int	nlines;
 {
+    oc_calls[OC_SCROLL]++;
     return tcscroll(scr, start_row, end_row, nlines, TRUE);
 }
 
 /*
- * This function has exactly the same return value as scroll() above,
- * but it doesn't do the scrolling - it just returns true or false.
+ * This function returns true if scroll() above would succeed, but it
+ * doesn't do the scrolling; the value returned is its estimated cost.
  */
 static int
 can_scroll(scr, start_row, end_row, nlines)
@@ -704,8 +983,30 @@ static void
 flushout(scr)
 VirtScr	*scr;
 {
+    long	size;
+
     xyupdate();
-    oflush();
+
+    oc_charge(OC_OTHER);
+    size = obcount() - oc_update;
+    if (size > 0) {
+	oc_updates++;
+	if (size > oc_maxupdate)
+	    oc_maxupdate = size;
+    }
+
+    /*
+     * If the syncupdate parameter is set, ask the terminal to show
+     * anything bigger than about a line's worth of output all at once,
+     * so that it isn't seen half-drawn.
+     */
+    if (Pb(P_syncupdate) && obused > CO) {
+	oframe("\033[?2026h", "\033[?2026l");
+    } else {
+	oflush();
+    }
+    oc_charge(OC_OTHER);
+    oc_update = obcount();
 }
 
 /*
@@ -718,11 +1019,13 @@ static void
 pbeep(scr)
 VirtScr	*scr;
 {
+    oc_calls[OC_OTHER]++;
     if (Pb(P_vbell) && VB != NULL) {
 	xyupdate();
-	tputs(VB, (int) scr->pv_rows, foutch);
+	outcap(VB, (int) scr->pv_rows, OC_OTHER);
 	optimise = FALSE;
     } else {
+	oc_charge(OC_OTHER);
 	moutch('\007');
     }
     oflush();
@@ -770,6 +1073,7 @@ register int	c;
 {
     xyupdate();
     do_set_colour(new_colour);
+    oc_charge(OC_TEXT);
     real_col++;
     virt_col++;
     moutch(c);
@@ -786,6 +1090,7 @@ register char	*s;
 {
     xyupdate();
     do_set_colour(new_colour);
+    oc_charge(OC_TEXT);
     while (*s != '\0') {
 	real_col++;
 	virt_col++;
@@ -833,6 +1138,94 @@ int c;
     return(c);
 }
 
+/*
+ * Return the number of bytes, including padding, in the given
+ * termcap string when output with the given number of lines affected.
+ */
+static int
+tccost(str, affcnt)
+char	*str;
+int	affcnt;
+{
+    if (str == NULL) {
+	return(0);
+    }
+    cost = 0;
+    tputs(str, affcnt, inc_cost);
+    return(cost);
+}
+
+/*
+ * Charge everything sent since the last call to the category we
+ * were sending then, and start sending the given category.
+ */
+static void
+oc_charge(category)
+int	category;
+{
+    long	now;
+
+    now = obcount();
+    oc_bytes[oc_cat] += now - oc_mark;
+    oc_mark = now;
+    oc_cat = category;
+}
+
+/*
+ * Send a termcap string, counting it as a sequence of the given category.
+ */
+static void
+outcap(str, affcnt, category)
+char	*str;
+int	affcnt;
+int	category;
+{
+    oc_charge(category);
+    oc_seqs[category]++;
+    tputs(str, affcnt, foutch);
+}
+
+/*
+ * Return line number n of the ":outstats" display, or NULL
+ * if there are no more; a negative n resets the counts.
+ */
+/*ARGSUSED*/
+static char *
+outstats(scr, n)
+VirtScr	*scr;
+int	n;
+{
+    static Flexbuf	line;
+    unsigned long	total;
+    int			i;
+
+    oc_charge(oc_cat);
+    if (n < 0) {
+	for (i = 0; i < NOC; i++) {
+	    oc_bytes[i] = oc_seqs[i] = oc_calls[i] = 0;
+	}
+	oc_updates = oc_maxupdate = 0;
+	return(NULL);
+    }
+
+    flexclear(&line);
+    if (n < NOC) {
+	(void) lformat(&line, "%-15s %8lu bytes, %6lu sequences, %6lu calls",
+		oc_names[n], oc_bytes[n], oc_seqs[n], oc_calls[n]);
+    } else if (n == NOC) {
+	total = 0;
+	for (i = 0; i < NOC; i++) {
+	    total += oc_bytes[i];
+	}
+	(void) lformat(&line,
+		"%-15s %8lu bytes in %lu updates, %lu in the biggest",
+		"Total:", total, oc_updates, oc_maxupdate);
+    } else {
+	return(NULL);
+    }
+    return(flexgetstr(&line));
+}
+
 /*
  * Look up term entry in termcap database, and set up all the strings.
  */
@@ -1008,6 +1401,9 @@ unsigned int	*pcolumns;
     IC = tgetstr("ic", &strp);
     IM = tgetstr("im", &strp);
     EI = tgetstr("ei", &strp);
+    DC = tgetstr("dc", &strp);
+    DM = tgetstr("dm", &strp);
+    ED = tgetstr("ed", &strp);
     CM = tgetstr("cm", &strp);
     HO = tgetstr("ho", &strp);
     CS = tgetstr("cs", &strp);
@@ -1016,6 +1412,10 @@ unsigned int	*pcolumns;
     SF = tgetstr("SF", &strp);
     SR = tgetstr("SR", &strp);
     VB = tgetstr("vb", &strp);
+    BE = tgetstr("BE", &strp);
+    BD = tgetstr("BD", &strp);
+    PS = tgetstr("PS", &strp);
+    PE = tgetstr("PE", &strp);
     MR = tgetstr("mr", &strp);
     MD = tgetstr("md", &strp);
     ME = tgetstr("me", &strp);
@@ -1041,6 +1441,15 @@ unsigned int	*pcolumns;
 	colours[ncolours] = cap;
     }
 
+    /*
+     * We need all four capabilities for bracketed paste,
+     * and PS must fit in held[].
+     */
+    if (BE == NULL || BD == NULL || PS == NULL || PE == NULL ||
+	    PS[0] == '\0' || PE[0] == '\0' || strlen(PS) > sizeof(held)) {
+	BE = BD = PS = PE = NULL;
+    }
+
     if (CM == NULL && HO == NULL) {
 	fail("Xvi can't work without cursor motion or home.");
     }
@@ -1096,11 +1505,13 @@ tty_startv()
 {
     if (termmode == m_SYS) {
 	if (TI != NULL)
-	    tputs(TI, (int) LI, foutch);
+	    outcap(TI, (int) LI, OC_OTHER);
 	if (VS != NULL)
-	    tputs(VS, (int) LI, foutch);
+	    outcap(VS, (int) LI, OC_OTHER);
 	if (KS != NULL)
-	    tputs(KS, (int) LI, foutch);
+	    outcap(KS, (int) LI, OC_OTHER);
+	if (BE != NULL)
+	    outcap(BE, 1, OC_OTHER);
     }
     old_colour = NO_COLOUR;
     pset_colour(&tcap_scr, VSCcolour);
@@ -1122,12 +1533,14 @@ tty_endv()
 	if (can_scroll_area) {
 	    set_scroll_region(0, (int) LI - 1);
 	}
+	if (BD != NULL)
+	    outcap(BD, 1, OC_OTHER);
 	if (KE != NULL)
-	    tputs(KE, (int) LI, foutch);
+	    outcap(KE, (int) LI, OC_OTHER);
 	if (VE != NULL)
-	    tputs(VE, (int) LI, foutch);
+	    outcap(VE, (int) LI, OC_OTHER);
 	if (TE != NULL)
-	    tputs(TE, (int) LI, foutch);
+	    outcap(TE, (int) LI, OC_OTHER);
 	flushout(&tcap_scr);
 	termmode = m_SYS;
     }
@@ -1141,7 +1554,7 @@ erase_line()
 {
     xyupdate();
     if (CE != NULL) {
-	tputs(CE, (int) LI, foutch);
+	outcap(CE, (int) LI, OC_CLEAR);
     } else {
 	/*
 	 * This happens when unix.c calls erase_line() in sys_endv() to clear
@@ -1152,6 +1565,7 @@ erase_line()
 	 * As we know we are clearing the status line, don't do the last
 	 * character of the line.
 	 */
+	oc_charge(OC_CLEAR);
 	while (real_col < CO-1) {
 	    moutch(' ');
 	    real_col++;
@@ -1167,7 +1581,7 @@ delete_a_line()
 {
     xyupdate();
     if (DL != NULL)
-	tputs(DL, (int) LI, foutch);
+	outcap(DL, (int) LI, OC_SCROLL);
 }
 
 /*
@@ -1183,8 +1597,7 @@ erase_display()
     optimise = FALSE;
     old_colour = NO_COLOUR;
     if (CL != NULL)
-	tputs(CL, (int) LI, foutch);
-    oflush();
+	outcap(CL, (int) LI, OC_CLEAR);
 }
 
 /*
@@ -1198,7 +1611,7 @@ set_scroll_region(top, bottom)
 int	top, bottom;
 {
     if (top != s_top || bottom != s_bottom) {
-	tputs(tgoto(CS, bottom, top), bottom - top, foutch);
+	outcap(tgoto(CS, bottom, top), bottom - top, OC_SCROLL);
 	s_top = top;
 	s_bottom = bottom;
 	/*
@@ -1272,24 +1685,24 @@ int	start_row, end_row, nlines;
      * or by the appropriate number of line insertions.
      */
     if (SF != NULL && (nlines > 1 || sf == NULL)) {
-	tputs(tgoto(SF, nlines, nlines), end_row - start_row, foutch);
+	outcap(tgoto(SF, nlines, nlines), end_row - start_row, OC_SCROLL);
     } else if (sf != NULL) {
 	int	i;
 
 	for (i = 0; i < nlines; i++) {
-	    tputs(sf, end_row - start_row, foutch);
+	    outcap(sf, end_row - start_row, OC_SCROLL);
 	}
     } else if (DL != NULL) {
 	int	i;
 
 	for (i = 0; i < nlines; i++) {
-	    tputs(DL, end_row - start_row, foutch);
+	    outcap(DL, end_row - start_row, OC_SCROLL);
 	}
     } else {
 	int	i;
 
 	for (i = 0; i < nlines; i++) {
-	    tputs(down, 1, foutch);
+	    outcap(down, 1, OC_SCROLL);
 	}
     }
 
@@ -1355,18 +1768,18 @@ int	start_row, end_row, nlines;
      * or by the appropriate number of line insertions.
      */
     if (SR != NULL && (nlines > 1 || sr == NULL)) {
-	tputs(tgoto(SR, nlines, nlines), end_row - start_row, foutch);
+	outcap(tgoto(SR, nlines, nlines), end_row - start_row, OC_SCROLL);
     } else if (sr != NULL) {
 	int	i;
 
 	for (i = 0; i < nlines; i++) {
-	    tputs(sr, end_row - start_row, foutch);
+	    outcap(sr, end_row - start_row, OC_SCROLL);
 	}
     } else {
 	int	i;
 
 	for (i = 0; i < nlines; i++) {
-	    tputs(AL, end_row - start_row, foutch);
+	    outcap(AL, end_row - start_row, OC_SCROLL);
 	}
     }
 
@@ -1391,12 +1804,12 @@ char	c;
 {
     xyupdate();
     if (IC != NULL) {
-	tputs(IC, (int) LI, foutch);
+	outcap(IC, (int) LI, OC_INSDEL);
 	outchar(c);
     } else if (IM != NULL) {
-	tputs(IM, (int) LI, foutch);
+	outcap(IM, (int) LI, OC_INSDEL);
 	outchar(c);
-	tputs(EI, (int) LI, foutch);
+	outcap(EI, (int) LI, OC_INSDEL);
     }
 }
 
@@ -1477,6 +1890,7 @@ cm_right_by_redraw(bool_t doit)
 		ch = sline->s_line[real_col];
 	    }
 	    do_set_colour(colour);
+	    oc_charge(OC_MOTION);
 	    moutch(ch);
 	    real_col++;
 	}
@@ -1523,7 +1937,7 @@ bool_t	doit;
 	/* First option: Output carriage return and redraw screen characters */
 	if (crcost < bscost) {
 	    if (doit) {
-		tputs(cr, 1, foutch);
+		outcap(cr, 1, OC_MOTION);
 		real_col = 0;
 	        return(cm_right_by_redraw(TRUE));
 	    } else {
@@ -1535,7 +1949,7 @@ bool_t	doit;
 	if (bscost != NOCM) {
 	    if (doit) {
 		while (virt_col < real_col) {
-		    tputs(bc, 1, foutch);
+		    outcap(bc, 1, OC_MOTION);
 		    real_col--;
 		}
 	    }
@@ -1565,7 +1979,7 @@ bool_t	doit;
 	    int cost = cost_up * (real_row - virt_row);
 	    if (doit) {
 		while (virt_row < real_row) {
-		    tputs(up, 1, foutch);
+		    outcap(up, 1, OC_MOTION);
 		    real_row--;
 		}
 	    }
@@ -1579,7 +1993,7 @@ bool_t	doit;
 	    int cost = (virt_row - real_row) * cost_down;
 	    if (doit) {
 		while (virt_row > real_row) {
-		    tputs(down, 1, foutch);
+		    outcap(down, 1, OC_MOTION);
 		    real_row++;
 		}
 	    }
@@ -1607,10 +2021,12 @@ bool_t	doit;
 {
     if (CM != NULL) {
 	cost = 0;	/* the global one */
-	tputs(tgoto(CM, virt_col, virt_row), (int)LI, doit ? foutch : inc_cost);
 	if (doit) {
+	    outcap(tgoto(CM, virt_col, virt_row), (int)LI, OC_MOTION);
 	    real_row = virt_row;
 	    real_col = virt_col;
+	} else {
+	    tputs(tgoto(CM, virt_col, virt_row), (int)LI, inc_cost);
 	}
 	return(cost);
     }
@@ -1621,7 +2037,7 @@ bool_t	doit;
 	int save_real_row = real_row;
 
 	if (doit) {
-	    tputs(HO, 1, foutch);
+	    outcap(HO, 1, OC_MOTION);
 	}
 	real_col = real_row = 0;    /* if !doit, just pretend we went home */
 	cost += cm_relative(doit);
@@ -28,7 +28,16 @@ main(argc, argv)
 int	argc;
 char	*argv[];
 {
-    tcap_scr_main(argc, argv);
+    /*
+     * "-H" as the first argument runs the editor with no
+     * terminal, drawing on a screen in memory (see memscr.c).
+     */
+    if (argc > 1 && strcmp(argv[1], "-H") == 0) {
+	argv[1] = argv[0];
+	memscr_main(argc - 1, argv + 1);
+    } else {
+	tcap_scr_main(argc, argv);
+    }
     exit(0);
 }
 
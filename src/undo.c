@@ -47,6 +47,7 @@ static	bool_t	init_change_data P((void));
 static	void	free_changes P((Change *));
 static	Change	*_replchars P((Line *, int, int, char *));
 static	Change	*_repllines P((Line *, long, Line *));
+static	Change	*_movelines P((Line *, Line *, Line *));
 static	void	report P((void));
 
 void
@@ -268,6 +269,30 @@ Line		*newlines;
     }
 }
 
+/*
+ * Interface used by rest of editor code to _movelines(),
+ * as for repllines().
+ */
+void
+movelines(first, last, dest)
+Line		*first;
+Line		*last;
+Line		*dest;
+{
+    ChangeData	*cdp = curbuf->b_change;
+    Change	*change;
+
+    if (!init_change_data()) {
+	return;
+    }
+
+    change = _movelines(first, last, dest);
+
+    if (change != NULL) {
+	push_change(&(cdp->cd_undo), change);
+    }
+}
+
 /*
  * Replace the given section of the given line with the
  * new (null-terminated) string. nchars may be zero for
@@ -275,12 +300,9 @@ Line		*newlines;
  * string to delete text. start is the first character
  * of the section which is to be replaced.
  *
- * Note that we don't call strcpy() to copy text here, for
- * two reasons: firstly, we are likely to be copying small
- * numbers of characters and it is therefore faster to do
- * the copying ourselves, and secondly, strcpy() doesn't
- * necessarily work for copying overlapping text towards
- * higher locations in memory.
+ * The text after the section is moved with memmove(), which
+ * copes with overlapping text, unlike strcpy(); a character
+ * inserted near the start of a long line moves all the rest.
  */
 static Change *
 _replchars(line, start, nchars, newstring)
@@ -334,47 +356,38 @@ char	*newstring;
     change->c_index = start;
     change->c_nchars = nlen;
 
-    if (offset > 0) {
-	register char	*s;
+    /*
+     * Take a copy of the text first if it is shared.
+     */
+    if (own_text(line) == FALSE) {
+	if (nchars != 0) free(change->c_chars);
+	chfree(change);
+	State = NORMAL;
+	return(NULL);
+    }
 
+    if (offset > 0) {
 	/*
 	 * Move existing text along by offset to the right.
 	 * First make some room in the line.
 	 */
-	if (grow_line(line, offset) == FALSE) {
+	if (grow_line(line, start + olen, offset) == FALSE) {
 	    if (nchars != 0) free(change->c_chars);
 	    chfree(change);
 	    State = NORMAL;
 	    return(NULL);
 	}
 
-	/*
-	 * Copy characters backwards, i.e. start
-	 * at the end of the line rather than at
-	 * the start.
-	 */
 	from = line->l_text + start;
-	to = from + offset + olen + 1;
-	s = from + olen + 1;
-	while (s > from) {
-	    *--to = *--s;
-	}
+	(void) memmove(from + offset, from, (size_t) olen + 1);
 
     } else if (offset < 0) {
 
 	/*
 	 * Move existing text along to the left.
 	 */
-	offset = - offset;
 	to = line->l_text + start;
-	from = to + offset;
-
-	/*
-	 * Do classic K&R strcpy().
-	 */
-	while ((*to++ = *from++) != '\0') {
-	    ;
-	}
+	(void) memmove(to, to - offset, (size_t) (olen + offset) + 1);
     }
 
     /*
@@ -387,6 +400,9 @@ char	*newstring;
     while (*from != '\0') {
 	*to++ = *from++;
     }
+    line->l_version++;
+    cells_replaced(line, start, nlen, (nchars != 0) ? change->c_chars : "");
+    colschanged(line, start);
 
     buffer->b_flags |= FL_MODIFIED;
 
@@ -703,6 +719,109 @@ cont2:	set_curwin(xvNextWindow(wp));
     return(change);
 }
 
+/*
+ * Move the lines from first to last inclusive so that they follow
+ * dest, which must not be one of them (but may be b_line0).
+ *
+ * The lines are just unlinked and linked in again at their new place,
+ * so marks on them stay where they are, and the change is recorded by
+ * line numbers only. Only the lines between the old and new places
+ * have to be renumbered. The screen is not updated.
+ */
+static Change *
+_movelines(first, last, dest)
+Line		*first;
+Line		*last;
+Line		*dest;
+{
+    register Buffer	*buffer = curbuf;
+    Line		*prev;		/* line before the moved lines */
+    Line		*next;		/* line after the moved lines */
+    Line		*from;		/* line before those to renumber */
+    Line		*stay;		/* line now where they were */
+    register Line	*p;
+    register Xviwin	*wp;
+    long		nlines;		/* no. of lines moved */
+    long		n;		/* no. of lines to renumber */
+    unsigned long	l;
+    Change		*change;
+
+    change = challoc();
+    if (change == NULL) {
+	return(NULL);
+    }
+    change->c_type = C_MOVE;
+
+    prev = first->l_prev;
+    next = last->l_next;
+    nlines = last->l_number - first->l_number + 1;
+
+    /*
+     * The lines from the old place to the new one change their numbers,
+     * including the ones moved.
+     */
+    if (dest->l_number < first->l_number) {
+	from = dest;
+	n = last->l_number - dest->l_number;
+    } else {
+	from = prev;
+	n = dest->l_number - prev->l_number;
+    }
+
+    /*
+     * Windows whose top line or cursor is on one of the lines are left
+     * where the lines were, as they would be if the lines were deleted.
+     */
+    stay = (next != buffer->b_lastline) ? next : prev;
+    wp = curwin;
+    do {
+	if (wp->w_buffer != buffer || dest == prev)
+	    continue;
+
+	if (!earlier(wp->w_topline, first) && !later(wp->w_topline, last)) {
+	    wp->w_topline = stay;
+	}
+	if (!earlier(wp->w_cursor->p_line, first) &&
+				!later(wp->w_cursor->p_line, last)) {
+	    wp->w_cursor->p_line = stay;
+	    wp->w_cursor->p_index = 0;
+	}
+    } while ((wp = xvNextWindow(wp)) != curwin);
+
+    /*
+     * Take the lines out, and put them back after dest.
+     */
+    prev->l_next = next;
+    next->l_prev = prev;
+    last->l_next = dest->l_next;
+    dest->l_next->l_prev = last;
+    dest->l_next = first;
+    first->l_prev = dest;
+
+    /*
+     * Re-link the buffer file pointer
+     * in case we moved line 1.
+     */
+    buffer->b_file = buffer->b_line0->l_next;
+
+    l = from->l_number;
+    for (p = from->l_next; n-- > 0; p = p->l_next) {
+	p->l_number = ++l;
+    }
+
+    buffer->b_flags |= FL_MODIFIED;
+
+    /*
+     * To undo it, the lines are moved back to follow the
+     * line which was before them.
+     */
+    change->c_lineno = first->l_number;
+    change->c_mlines = nlines;
+    change->c_mdest = prev->l_number;
+
+    return(change);
+}
+
 /*
  * Replace the entire buffer with the specified list of lines.
  *
@@ -991,6 +1110,26 @@ undo()
 	    last_index = tmp->c_index;
 	    break;
 
+	case C_MOVE:
+	    {
+		Line	*last;
+		Line	*dest;
+		long	n;
+
+		for (last = lp, n = tmp->c_mlines; --n > 0;
+						last = last->l_next) {
+		    ;
+		}
+		dest = (tmp->c_mdest == 0) ? buffer->b_line0 :
+					gotoline(buffer, tmp->c_mdest);
+		change = _movelines(lp, last, dest);
+
+		if (lp->l_number < firstlinechanged) {
+		    firstlinechanged = lp->l_number;
+		}
+	    }
+	    break;
+
 	case C_POSITION:
 	    move_cursor(gotoline(buffer, (unsigned long) tmp->c_pline),
 			tmp->c_pindex);
@@ -1108,6 +1247,7 @@ Change	*chp;
 	    free(tmp->c_chars);
 	    break;
 	case C_DEL_CHAR:
+	case C_MOVE:
 	case C_POSITION:
 	    break;
 	}
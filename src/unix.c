@@ -59,9 +59,9 @@ FILE *fdopen(int fd, const char *mode);
 
 #if defined  _POSIX_C_SOURCE && _POSIX_C_SOURCE >= 200112L
 #include	<sys/select.h>
-#else
-#include	<sys/time.h>
 #endif
+#include	<sys/time.h>
+#include	<poll.h>
 
 #if defined(sun) && !defined(POSIX)
 #   ifndef TERMIOS
@@ -187,14 +187,23 @@ extern short		ospeed;			/* tty's baud rate */
 /*
  * We sometimes use a lot of system calls while trying to read from
  * the keyboard; these are needed to make our automatic buffer
- * preservation and input timeouts work properly. Nevertheless, it
- * is possible that, with this much overhead, a reasonably fast typist
- * could get ahead of us, so we do a small amount of input buffering
- * to reduce the number of system calls.
+ * preservation and input timeouts work properly. So that a burst of
+ * input, such as a paste or a scripted session, doesn't cost several
+ * system calls per character, keyboard input is kept in a ring buffer:
+ * whenever we read, we take everything that is there without waiting
+ * for more, growing the buffer up to KB_MAXSIZE if need be. kbread()
+ * lets the caller take what has arrived in bulk.
  *
- * This variable gives the number of characters in the buffer.
+ * kbhead is the index of the next character in the buffer, and
+ * kb_nchars gives the number of characters in it.
  */
-static int	kb_nchars;
+#define	KB_INITSIZE	1024
+#define	KB_MAXSIZE	(1024 * 1024)
+
+static unsigned char	*kbuf = NULL;
+static int		kbsize = 0;
+static int		kbhead = 0;
+static int		kb_nchars = 0;
 
 /*
  * The current input timeout to use for checking for pending
@@ -210,6 +219,489 @@ bool_t	subshells = FALSE;
 
 volatile bool_t	win_size_changed = FALSE;
 
+/*
+ * Screen output is collected here rather than in stdout's buffer,
+ * so that a whole screen update can be sent with a single write()
+ * instead of being chopped up into stdio-buffer-sized pieces, which
+ * terminals can show half-drawn. The buffer grows as needed; the
+ * first OB_RESERVE bytes are kept free so that oframe() can put a
+ * prefix in front of the data without copying it.
+ *
+ * moutch() (in unix.h) adds to the buffer directly while there is
+ * room, and calls obputc() when there isn't.
+ */
+#define	OB_RESERVE	16
+#define	OB_INITSIZE	4096
+#define	OB_MAXSIZE	65536
+
+char	*obuf = NULL;
+int	obused = 0;
+int	obsize = 0;
+long	obsent = 0;		/* bytes sent from it so far */
+
+static	char	*obmem = NULL;
+
+static void
+obwrite(p, n)
+char	*p;
+int	n;
+{
+    int		nw;
+
+    obsent += n;
+    while (n > 0) {
+	nw = write(1, p, (unsigned) n);
+	if (nw < 0) {
+	    if (errno == EINTR)
+		continue;
+	    break;
+	}
+	p += nw;
+	n -= nw;
+    }
+}
+
+/*
+ * Make the buffer bigger; return FALSE if we can't, or if
+ * it's already as big as we want it to get.
+ */
+static bool_t
+obgrow()
+{
+    unsigned	newsize;
+    char	*newmem;
+
+    if (obsize >= OB_MAXSIZE)
+	return(FALSE);
+    newsize = (obsize == 0) ? OB_INITSIZE : obsize * 2;
+    newmem = (obmem == NULL) ?
+		malloc(newsize + OB_RESERVE) :
+		realloc(obmem, newsize + OB_RESERVE);
+    if (newmem == NULL)
+	return(FALSE);
+    obmem = newmem;
+    obuf = obmem + OB_RESERVE;
+    obsize = newsize;
+    return(TRUE);
+}
+
+void
+obputc(c)
+int	c;
+{
+    if (obused >= obsize && !obgrow()) {
+	if (obsize == 0) {
+	    char	ch = c;
+
+	    obwrite(&ch, 1);
+	    return;
+	}
+	/*
+	 * Can't grow it; just send what we have.
+	 */
+	oflush();
+    }
+    obuf[obused++] = c;
+}
+
+/*
+ * Send any buffered screen output. Anything written to stdout
+ * through stdio is sent first, to keep the two in order.
+ */
+void
+oflush()
+{
+    (void) fflush(stdout);
+    if (obused > 0) {
+	obwrite(obuf, obused);
+	obused = 0;
+    }
+}
+
+/*
+ * Send any buffered screen output, with the strings begin and
+ * end around it, in a single write(). If we can't make room for
+ * them, the data is sent without them.
+ */
+void
+oframe(begin, end)
+char	*begin;
+char	*end;
+{
+    int		blen, elen;
+
+    (void) fflush(stdout);
+    if (obused == 0)
+	return;
+    blen = strlen(begin);
+    elen = strlen(end);
+    while (obused + elen > obsize) {
+	if (!obgrow()) {
+	    oflush();
+	    return;
+	}
+    }
+    if (blen > OB_RESERVE) {
+	blen = 0;
+    }
+    (void) memcpy(obuf + obused, end, (unsigned) elen);
+    (void) memcpy(obuf - blen, begin, (unsigned) blen);
+    obwrite(obuf - blen, blen + obused + elen);
+    obused = 0;
+}
+
+/*
+ * While we wait for the keyboard, we can also wait for input on other
+ * file descriptors and for timers to expire, and call a function for
+ * each of them. This lets background work such as the tags loader
+ * tell us it has finished without anyone having to wait for it.
+ *
+ * The functions are only called from inside kbwait(), i.e. while the
+ * editor is idle waiting for input, so they can use the editor's data
+ * freely. Timers are kept in a heap ordered by expiry time; times are
+ * in milliseconds since the first call of sys_msclock().
+ */
+#define	MAXWATCH	8
+
+static struct watch {
+    int		w_fd;
+    void	(*w_func) P((int, genptr *));
+    genptr	*w_arg;
+}		watches[MAXWATCH];
+static int	nwatches = 0;
+
+typedef struct {
+    long	t_when;			/* when it expires */
+    long	t_id;			/* handle given to sys_addtimer() caller */
+    void	(*t_func) P((genptr *));
+    genptr	*t_arg;
+} Timer;
+
+static Timer	*timers = NULL;		/* the heap */
+static int	ntimers = 0;
+static int	maxtimers = 0;
+static long	lasttimerid = 0;
+
+static void	timerdown P((int));
+static void	timerup P((int));
+static void	runtimers P((void));
+static bool_t	kbwait P((long));
+
+/*
+ * Return the time in milliseconds since we were first called.
+ */
+long
+sys_msclock()
+{
+    static long		base = -1;
+    struct timeval	tv;
+
+    (void) gettimeofday(&tv, (struct timezone *) NULL);
+    if (base < 0) {
+	base = (long) tv.tv_sec;
+    }
+    return(((long) tv.tv_sec - base) * 1000 + (long) tv.tv_usec / 1000);
+}
+
+/*
+ * Start watching fd for input, calling func(fd, arg) when there is
+ * some; if func is NULL, stop watching it. Return FALSE if there
+ * are too many already.
+ */
+bool_t
+sys_watchfd(fd, func, arg)
+int	fd;
+void	(*func) P((int, genptr *));
+genptr	*arg;
+{
+    int		i;
+
+    for (i = 0; i < nwatches && watches[i].w_fd != fd; i++) {
+	;
+    }
+    if (func == NULL) {
+	if (i < nwatches) {
+	    watches[i] = watches[--nwatches];
+	}
+	return(TRUE);
+    }
+    if (i == nwatches) {
+	if (nwatches >= MAXWATCH) {
+	    return(FALSE);
+	}
+	nwatches++;
+    }
+    watches[i].w_fd = fd;
+    watches[i].w_func = func;
+    watches[i].w_arg = arg;
+    return(TRUE);
+}
+
+/*
+ * Arrange for func(arg) to be called in ms milliseconds' time.
+ * Return a handle for sys_deltimer(), or 0 if we can't.
+ */
+long
+sys_addtimer(ms, func, arg)
+long	ms;
+void	(*func) P((genptr *));
+genptr	*arg;
+{
+    if (ntimers >= maxtimers) {
+	int	newmax;
+	Timer	*newtimers;
+
+	newmax = (maxtimers == 0) ? 8 : maxtimers * 2;
+	newtimers = (timers == NULL) ?
+		(Timer *) malloc(newmax * sizeof(Timer)) :
+		(Timer *) realloc((char *) timers, newmax * sizeof(Timer));
+	if (newtimers == NULL) {
+	    return(0);
+	}
+	timers = newtimers;
+	maxtimers = newmax;
+    }
+    timers[ntimers].t_when = sys_msclock() + ms;
+    timers[ntimers].t_id = ++lasttimerid;
+    timers[ntimers].t_func = func;
+    timers[ntimers].t_arg = arg;
+    timerup(ntimers++);
+    return(lasttimerid);
+}
+
+/*
+ * Cancel a timer which hasn't gone off yet.
+ */
+void
+sys_deltimer(id)
+long	id;
+{
+    int		i;
+
+    for (i = 0; i < ntimers; i++) {
+	if (timers[i].t_id == id) {
+	    timers[i] = timers[--ntimers];
+	    if (i < ntimers) {
+		timerup(i);
+		timerdown(i);
+	    }
+	    return;
+	}
+    }
+}
+
+/*
+ * Restore the heap order by moving timers[i] up or down.
+ */
+static void
+timerup(i)
+int	i;
+{
+    Timer	t;
+
+    t = timers[i];
+    while (i > 0 && timers[(i - 1) / 2].t_when > t.t_when) {
+	timers[i] = timers[(i - 1) / 2];
+	i = (i - 1) / 2;
+    }
+    timers[i] = t;
+}
+
+static void
+timerdown(i)
+int	i;
+{
+    Timer	t;
+    int		child;
+
+    t = timers[i];
+    while ((child = 2 * i + 1) < ntimers) {
+	if (child + 1 < ntimers &&
+			timers[child + 1].t_when < timers[child].t_when) {
+	    child++;
+	}
+	if (timers[child].t_when >= t.t_when) {
+	    break;
+	}
+	timers[i] = timers[child];
+	i = child;
+    }
+    timers[i] = t;
+}
+
+/*
+ * Call the functions for any timers which have expired.
+ */
+static void
+runtimers()
+{
+    long	now;
+
+    now = sys_msclock();
+    while (ntimers > 0 && timers[0].t_when <= now) {
+	Timer	t;
+
+	t = timers[0];
+	timers[0] = timers[--ntimers];
+	if (ntimers > 0) {
+	    timerdown(0);
+	}
+	(*t.t_func)(t.t_arg);
+    }
+}
+
+/*
+ * Wait up to timeout milliseconds for keyboard input, dealing with
+ * watched file descriptors and timers meanwhile. Return TRUE if there
+ * is keyboard input to read, or FALSE if we timed out or were
+ * interrupted.
+ */
+static bool_t
+kbwait(timeout)
+long	timeout;
+{
+    struct pollfd	pfd[MAXWATCH + 1];
+    long		deadline;
+    long		wait;
+    int			n;
+    int			i;
+
+    deadline = sys_msclock() + timeout;
+    while (1) {
+	runtimers();
+
+	wait = deadline - sys_msclock();
+	if (ntimers > 0 && timers[0].t_when - sys_msclock() < wait) {
+	    wait = timers[0].t_when - sys_msclock();
+	}
+	if (wait < 0) {
+	    wait = 0;
+	}
+
+	pfd[0].fd = 0;
+	pfd[0].events = POLLIN;
+	for (n = 0; n < nwatches; n++) {
+	    pfd[n + 1].fd = watches[n].w_fd;
+	    pfd[n + 1].events = POLLIN;
+	}
+	n++;
+
+	if (poll(pfd, n, (int) wait) < 0) {
+	    if (kbdintr || errno != EINTR) {
+		return(FALSE);
+	    }
+	    continue;
+	}
+	if (pfd[0].revents != 0) {
+	    return(TRUE);
+	}
+
+	/*
+	 * The functions may change the list, so we look
+	 * each descriptor up again before calling its function.
+	 */
+	for (i = 1; i < n; i++) {
+	    if (pfd[i].revents != 0) {
+		int	w;
+
+		for (w = 0; w < nwatches && watches[w].w_fd != pfd[i].fd; w++) {
+		    ;
+		}
+		if (w < nwatches) {
+		    (*watches[w].w_func)(pfd[i].fd, watches[w].w_arg);
+		}
+	    }
+	}
+
+	if (kbdintr || (sys_msclock() >= deadline &&
+			    (ntimers == 0 || timers[0].t_when > sys_msclock()))) {
+	    return(FALSE);
+	}
+    }
+}
+
+/*
+ * Return TRUE if read() on the keyboard won't have to wait.
+ */
+static bool_t
+kbready()
+{
+    struct pollfd	pfd;
+
+    pfd.fd = 0;
+    pfd.events = POLLIN;
+    return(poll(&pfd, 1, 0) > 0);
+}
+
+/*
+ * Make the keyboard buffer bigger; return FALSE if we can't, or if
+ * it's already as big as we want it to get. If the characters in it
+ * wrap round the end, the wrapped part is moved into the new space
+ * to keep them in order.
+ */
+static bool_t
+kbgrow()
+{
+    int			newsize;
+    int			wrapped;
+    unsigned char	*newmem;
+
+    if (kbsize >= KB_MAXSIZE)
+	return(FALSE);
+    newsize = (kbsize == 0) ? KB_INITSIZE : kbsize * 2;
+    newmem = (kbuf == NULL) ?
+		(unsigned char *) malloc((unsigned) newsize) :
+		(unsigned char *) realloc((char *) kbuf, (unsigned) newsize);
+    if (newmem == NULL)
+	return(FALSE);
+    wrapped = kbhead + kb_nchars - kbsize;
+    if (wrapped > 0) {
+	(void) memcpy((char *) newmem + kbsize, (char *) newmem,
+							(unsigned) wrapped);
+    }
+    kbuf = newmem;
+    kbsize = newsize;
+    return(TRUE);
+}
+
+/*
+ * Read all the keyboard input that is available into the buffer,
+ * without waiting for any more. Return the number of characters read,
+ * or -1 if the first read() found end of file or an error.
+ */
+static int
+kbfill()
+{
+    int		total = 0;
+
+    do {
+	int	tail;
+	int	space;
+	int	nread;
+
+	if (kb_nchars >= kbsize && !kbgrow()) {
+	    break;
+	}
+	if (kb_nchars == 0) {
+	    kbhead = 0;
+	}
+	tail = kbhead + kb_nchars;
+	if (tail >= kbsize) {
+	    tail -= kbsize;
+	    space = kbhead - tail;
+	} else {
+	    space = kbsize - tail;
+	}
+	if ((nread = read(0, (char *) kbuf + tail, (unsigned) space)) <= 0) {
+	    return((total > 0) ? total : -1);
+	}
+	kb_nchars += nread;
+	total += nread;
+    } while (kbready());
+
+    return(total);
+}
+
 /*
  * Get a single byte from the keyboard.
  *
@@ -222,37 +714,20 @@ volatile bool_t	win_size_changed = FALSE;
 static int
 kbgetc()
 {
-    static unsigned char	kbuf[48];
-    static unsigned char	*kbp;
+    int		c;
 
     if (kbdintr)
 	return EOF;
 
     if (kb_nchars <= 0) {
-        fd_set rfds;
-        struct timeval tv;
-        int retval;
-        int nread;
-
 	/* Wait until there is some input to be read */
-        FD_ZERO(&rfds);
-        FD_SET(0, &rfds);
-        while (1) {
-	    tv.tv_sec = (long) (current_timeout / 1000);
-	    tv.tv_usec = ((long) current_timeout * 1000) % (long) 1000000;
-            retval = select(1, &rfds, NULL, NULL, &tv);
-            if (retval > 0)
-                 break;
-            if (retval == 0 || kbdintr)
-                return EOF;
-        }
-
-	if ((nread = read(0, (char *) kbuf, sizeof kbuf)) <= 0) {
+	if (!kbwait(current_timeout)) {
+	    return EOF;
+	}
+
+	if (kbfill() <= 0) {
 	    SIG_user_disconnected = TRUE;
 	    return EOF;
-	} else {
-	    kb_nchars = nread;
-	    kbp = kbuf;
 	}
     }
     if (win_size_changed) {
@@ -264,8 +739,11 @@ kbgetc()
 	 */
 	return(EOF);
     }
+    c = kbuf[kbhead];
+    if (++kbhead >= kbsize)
+	kbhead = 0;
     --kb_nchars;
-    return(*kbp++);
+    return(c);
 }
 
 /*
@@ -291,7 +769,7 @@ long	timeout;
     /*
      * Need to get a character. First, flush output to the screen.
      */
-    (void) fflush(stdout);
+    oflush();
 
     if (timeout != 0) {
 	current_timeout = timeout;
@@ -308,6 +786,51 @@ long	timeout;
     return(kbgetc());
 }
 
+/*
+ * Return TRUE if there is keyboard input waiting to be read,
+ * either in our own buffer or in the terminal driver.
+ */
+bool_t
+kbpending()
+{
+    return(kb_nchars > 0 || kbready());
+}
+
+/*
+ * Copy up to n characters of keyboard input which have already
+ * arrived into buf, without waiting for any more, and return the
+ * number copied. If stop is not EOF, we stop before the first
+ * occurrence of that character so the caller can look at it
+ * separately.
+ */
+int
+kbread(buf, n, stop)
+char	*buf;
+int	n;
+int	stop;
+{
+    int		i;
+
+    if (kbdintr || win_size_changed) {
+	return(0);
+    }
+    if (kb_nchars < n && kbready()) {
+	(void) kbfill();
+    }
+    for (i = 0; i < n && kb_nchars > 0; i++) {
+	int	c = kbuf[kbhead];
+
+	if (c == stop) {
+	    break;
+	}
+	buf[i] = c;
+	if (++kbhead >= kbsize)
+	    kbhead = 0;
+	--kb_nchars;
+    }
+    return(i);
+}
+
 #ifdef	NEED_STRERROR
 const char *
 strerror(err)
@@ -645,7 +1168,7 @@ sys_endv()
     erase_line();
     tty_endv();
 
-    (void) fflush(stdout);
+    oflush();
 
     /*
      * Restore terminal modes.
@@ -703,13 +1226,14 @@ int	code;
 
 /*
  * This is a routine that can be passed to tputs() (in the termcap
- * library): it does the same thing as putchar().
+ * library): it does the same thing as moutch().
  */
 int
 foutch(c)
 int	c;
 {
-    return(putchar(c));
+    moutch(c);
+    return(c);
 }
 
 /*
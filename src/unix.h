@@ -147,6 +147,10 @@
 
 #define	DIRSEPS		"/"	/* directory separators within pathnames */
 
+#define	HAVE_KBPENDING		/* we provide kbpending() */
+#define	HAVE_WATCHFD		/* and sys_watchfd() and sys_addtimer() */
+#define	HAVE_MSCLOCK		/* and sys_msclock() */
+
 /*
  * Default file format.
  */
@@ -154,9 +158,11 @@
 
 /*
  * These are needed for the termcap terminal interface module.
+ * Screen output goes into a buffer of our own (see unix.c).
  */
-#define oflush()	(void) fflush(stdout)
-#define moutch(c)	putchar(c)
+#define moutch(c)	((obused < obsize) ? \
+			    (void) (obuf[obused++] = (c)) : obputc(c))
+#define	obcount()	(obsent + obused)	/* bytes output so far */
 
 /*
  * Declarations for standard UNIX functions.
@@ -168,12 +174,25 @@ extern	int		rename P((const char *, const char *));
  */
 extern	char		*fexpand P((char *, bool_t));
 extern	int		foutch P((int));
+extern	char		*obuf;
+extern	int		obused;
+extern	int		obsize;
+extern	long		obsent;
+extern	void		obputc P((int));
+extern	void		oflush P((void));
+extern	void		oframe P((char *, char *));
 extern	void		Wait200ms P((void));
 extern	void		sys_init P((void));
 extern	void		sys_startv P((void));
 extern	void		sys_endv P((void));
 extern	void		sys_exit P((int));
 extern	int		inch P((long));
+extern	bool_t		kbpending P((void));
+extern	int		kbread P((char *, int, int));
+extern	bool_t		sys_watchfd P((int, void (*)(int, genptr *), genptr *));
+extern	long		sys_addtimer P((long, void (*)(genptr *), genptr *));
+extern	void		sys_deltimer P((long));
+extern	long		sys_msclock P((void));
 extern	int		call_shell P((char *));
 extern	int		call_system P((char *));
 extern	bool_t		sys_pipe P((char *, int (*)(FILE *), long (*)(FILE *)));
@@ -24,6 +24,12 @@
 #include "xvi.h"
 
 static	void	xvUpdateLine P((VirtScr *, int));
+static	void	xvFindScrolls P((VirtScr *, int, int));
+static	unsigned long	xvHashLine P((Sline *));
+static	int	xvRowCost P((Sline *, Sline *));
+static	void	xvShiftExt P((VirtScr *, int, int, int));
+static	void	xvShiftLine P((VirtScr *, int));
+static	int	xvShiftCost P((Sline *, Sline *, int, int, int));
 static	void	xvWriteMultiString
 		    P((VirtScr *, char *, int, unsigned char *, int, int));
 
@@ -49,6 +55,10 @@ int			nlines;
 
     VSset_colour(vs, VSCcolour);
 
+    if ((echo & e_SCROLL) && nlines > 1 && vs->v_scroll != NULL) {
+	xvFindScrolls(vs, start_row, end_row);
+    }
+
     for (row = start_row; row < end_row; row++) {
 	register unsigned	nflags;
 	register unsigned	rflags;		/* flags for current lines */
@@ -84,6 +94,318 @@ int			nlines;
     }
 }
 
+/*
+ * Approximate output costs, in bytes, used to decide whether scrolling
+ * part of the screen is cheaper than repainting the rows concerned.
+ * If VScan_scroll() doesn't give a cost, SCROLL_COST is taken for
+ * setting a scroll region and moving the cursor, and each line scrolled
+ * costs SCROLL_LINE more. ROW_COST is the cursor addressing overhead
+ * of repainting a row.
+ */
+#define	SCROLL_COST	24
+#define	SCROLL_LINE	4
+#define	ROW_COST	6
+
+static	unsigned long	*new_hash = NULL;	/* hashes of int_lines */
+static	unsigned long	*real_hash = NULL;	/* hashes of ext_lines */
+static	int		hash_rows = 0;		/* size of hash vectors */
+
+/*
+ * Look for blocks of rows which have moved vertically between the
+ * real and the new screen images, and scroll them into place before
+ * the rows are compared individually. This catches moves that the
+ * callers have not anticipated with s_ins() and s_del(), such as
+ * those caused by multi-line changes, undo or window redraws.
+ *
+ * Each row is hashed, and a row in the new image whose hash occurs
+ * exactly once in each image but at a different position is taken as
+ * the seed of a moved block, which is extended up and down for as long
+ * as the hashes continue to match. The block whose scroll saves most
+ * output is done, the real image is shifted to match and the search
+ * is repeated, until no scroll is worth doing. The hashes are only
+ * used to choose what to scroll; xvUpdateLine() still compares the
+ * rows themselves afterwards, so a collision cannot corrupt the screen.
+ */
+static void
+xvFindScrolls(vs, start_row, end_row)
+VirtScr		*vs;
+int		start_row;
+int		end_row;
+{
+    unsigned long	*nh;
+    unsigned long	*rh;
+    int			row;
+    int			tries;
+
+    if (hash_rows < end_row) {
+	unsigned long	*np;
+	unsigned long	*rp;
+
+	np = (unsigned long *) realloc((genptr *) new_hash,
+				    end_row * sizeof(unsigned long));
+	if (np != NULL) {
+	    new_hash = np;
+	}
+	rp = (unsigned long *) realloc((genptr *) real_hash,
+				    end_row * sizeof(unsigned long));
+	if (rp != NULL) {
+	    real_hash = rp;
+	}
+	if (np == NULL || rp == NULL) {
+	    return;
+	}
+	hash_rows = end_row;
+    }
+    nh = new_hash;
+    rh = real_hash;
+
+    for (row = start_row; row < end_row; row++) {
+	nh[row] = xvHashLine(&vs->pv_int_lines[row]);
+	rh[row] = xvHashLine(&vs->pv_ext_lines[row]);
+    }
+
+    for (tries = end_row - start_row; tries > 0; tries--) {
+	int	best_saved;		/* output saved by best scroll */
+	int	best_top, best_bot;	/* region for best scroll */
+	int	best_shift;		/* lines to scroll it by */
+	int	last_bot;		/* end of last block looked at */
+	int	last_shift;		/* and the distance it moved */
+
+	best_saved = 0;
+	best_top = best_bot = best_shift = 0;
+	last_bot = -1;
+	last_shift = 0;
+
+	for (row = start_row; row < end_row; row++) {
+	    int	match;		/* row in real image matching this one */
+	    int	top, bot;	/* first & last rows of moved block */
+	    int	shift;		/* distance moved up; negative for down */
+	    int	cost;		/* cost of scrolling the block into place */
+	    int	saved;
+	    int	r;
+
+	    if (nh[row] == rh[row] || vs->pv_int_lines[row].s_used == 0) {
+		continue;
+	    }
+
+	    /*
+	     * The row must be unique in both images, so that we
+	     * know which real row it has come from.
+	     */
+	    match = -1;
+	    for (r = start_row; r < end_row; r++) {
+		if (r != row && nh[r] == nh[row]) {
+		    break;
+		}
+		if (rh[r] == nh[row]) {
+		    if (match >= 0) {
+			break;
+		    }
+		    match = r;
+		}
+	    }
+	    if (r < end_row || match < 0) {
+		continue;
+	    }
+	    shift = match - row;
+	    if (row <= last_bot && shift == last_shift) {
+		/*
+		 * Already seen as part of the previous block.
+		 */
+		continue;
+	    }
+
+	    /*
+	     * Extend the block as far as it will go in each direction.
+	     */
+	    for (top = row; top > start_row && top + shift > start_row &&
+			    nh[top - 1] == rh[top - 1 + shift]; top--) {
+		;
+	    }
+	    for (bot = row; bot < end_row - 1 && bot + shift < end_row - 1 &&
+			    nh[bot + 1] == rh[bot + 1 + shift]; bot++) {
+		;
+	    }
+
+	    /*
+	     * Convert the block into the region which must be
+	     * scrolled to put it in place, and see how much output
+	     * doing so would save.
+	     */
+	    if (shift > 0) {
+		bot += shift;
+	    } else {
+		top += shift;
+	    }
+	    cost = VScan_scroll(vs, top, bot, shift);
+	    if (cost == 0) {
+		continue;
+	    }
+	    if (cost == 1) {
+		cost = SCROLL_COST + SCROLL_LINE * (shift > 0 ? shift : -shift);
+	    }
+
+	    saved = -cost;
+	    for (r = top; r <= bot; r++) {
+		Sline	*np = &vs->pv_int_lines[r];
+
+		saved += xvRowCost(np, &vs->pv_ext_lines[r]);
+		saved -= xvRowCost(np, (r + shift >= top && r + shift <= bot) ?
+				&vs->pv_ext_lines[r + shift] : (Sline *) NULL);
+	    }
+
+	    if (saved > best_saved) {
+		best_saved = saved;
+		best_top = top;
+		best_bot = bot;
+		best_shift = shift;
+	    }
+	}
+
+	if (best_saved <= 0 ||
+		    !VSscroll(vs, best_top, best_bot, best_shift)) {
+	    break;
+	}
+
+	/*
+	 * Make the real screen image match what has happened
+	 * on the screen.
+	 */
+	xvShiftExt(vs, best_top, best_bot, best_shift);
+	if (best_shift > 0) {
+	    for (row = best_top; row <= best_bot - best_shift; row++) {
+		rh[row] = rh[row + best_shift];
+	    }
+	    for ( ; row <= best_bot; row++) {
+		rh[row] = xvHashLine((Sline *) NULL);
+	    }
+	} else {
+	    for (row = best_bot; row >= best_top - best_shift; row--) {
+		rh[row] = rh[row + best_shift];
+	    }
+	    for ( ; row >= best_top; row--) {
+		rh[row] = xvHashLine((Sline *) NULL);
+	    }
+	}
+	for (row = best_top; row <= best_bot; row++) {
+	    xvMarkDirty(row);
+	}
+    }
+}
+
+/*
+ * Return a hash of the contents of the given screen line, which
+ * may be NULL to represent a blank line.
+ */
+static unsigned long
+xvHashLine(sp)
+Sline	*sp;
+{
+    register unsigned long	hash;
+    register char		*tp;
+    register unsigned char	*cp;
+    register int		n;
+
+    if (sp == NULL || sp->s_used == 0) {
+	return(0);
+    }
+
+    hash = (sp->s_flags & S_STATUS) + 1;
+    tp = sp->s_line;
+    cp = sp->s_colour;
+    for (n = sp->s_used; n > 0; n--) {
+	hash = (hash << 5) + hash + (unsigned char) *tp++;
+	hash = (hash << 5) + hash + *cp++;
+    }
+    return(hash);
+}
+
+/*
+ * Return the approximate cost of updating a row to the new contents
+ * given, when the real screen holds the line "rp", which may be NULL
+ * to represent a blank line. This mirrors what xvUpdateLine() does.
+ */
+static int
+xvRowCost(np, rp)
+Sline		*np;
+Sline		*rp;
+{
+    register int	col;
+    register int	cost;
+    int			n_used;
+    int			r_used;
+
+    n_used = np->s_used;
+    r_used = (rp == NULL) ? 0 : rp->s_used;
+
+    cost = 0;
+    for (col = 0; col < n_used && col < r_used; col++) {
+	if (np->s_line[col] != rp->s_line[col] ||
+			    np->s_colour[col] != rp->s_colour[col]) {
+	    cost++;
+	}
+    }
+    if (n_used > r_used) {
+	cost += n_used - r_used;
+    } else if (r_used > n_used) {
+	cost++;
+    }
+    return((cost == 0) ? 0 : cost + ROW_COST);
+}
+
+/*
+ * Shift the real screen lines between top and bot inclusive by the
+ * given number of rows, as VSscroll() has just done on the screen.
+ * We do this by rearranging the pointers within the Slines, rather
+ * than copying the characters; the lines uncovered are cleared.
+ */
+static void
+xvShiftExt(vs, top, bot, nlines)
+VirtScr		*vs;
+int		top;
+int		bot;
+int		nlines;
+{
+    register int	to;
+    int			step;
+    int			end;
+
+    if (nlines > 0) {
+	to = top;
+	end = bot - nlines;
+	step = 1;
+    } else {
+	to = bot;
+	end = top - nlines;
+	step = -1;
+    }
+
+    for ( ; to != end + step; to += step) {
+	register Sline	*lpfrom;
+	register Sline	*lpto;
+	char		*temp;
+	unsigned char	*ctemp;
+
+	lpfrom = &vs->pv_ext_lines[to + nlines];
+	lpto = &vs->pv_ext_lines[to];
+
+	temp = lpto->s_line;
+	lpto->s_line = lpfrom->s_line;
+	lpfrom->s_line = temp;
+	ctemp = lpto->s_colour;
+	lpto->s_colour = lpfrom->s_colour;
+	lpfrom->s_colour = ctemp;
+	lpto->s_used = lpfrom->s_used;
+	lpto->s_flags = lpfrom->s_flags;
+    }
+
+    for ( ; to != (nlines > 0 ? bot : top) + step; to += step) {
+	vs->pv_ext_lines[to].s_used = 0;
+	vs->pv_ext_lines[to].s_line[0] = '\0';
+	vs->pv_ext_lines[to].s_flags = 0;
+    }
+}
+
 /*
  * Update the given line to the screen. This routine is only called
  * if either the internal image, or the screen itself, has changed
@@ -110,6 +432,10 @@ int		row;
     new = vs->pv_int_lines + row;
     real = vs->pv_ext_lines + row;
 
+    if (vs->v_insert != NOFUNC || vs->v_delete != NOFUNC) {
+	xvShiftLine(vs, row);
+    }
+
     ntextp = new->s_line;
     rtextp = real->s_line;
     ncolours = new->s_colour;
@@ -171,6 +497,193 @@ int		row;
     real->s_used = n_used;
 }
 
+/*
+ * The largest number of characters xvShiftLine() will insert or
+ * delete, and the costs it assumes when VSinsdel_cost() doesn't know:
+ * CHAR_COST bytes to insert or delete each character. MOVE_COST is
+ * the cost of moving the cursor along a row, and CLEAR_COST that of
+ * clearing the end of one.
+ */
+#define	SHIFT_MAX	16
+#define	CHAR_COST	4
+#define	MOVE_COST	4
+#define	CLEAR_COST	3
+
+/*
+ * If the new version of the given row looks like the real one with
+ * a few characters inserted or deleted at the first point where they
+ * differ, and inserting or deleting them on the screen costs less
+ * than rewriting the rest of the row, do so and update the real
+ * screen image to match. xvUpdateLine() then writes whatever
+ * differences remain. This saves sending the tail of a long row
+ * again when typing or deleting characters near its start.
+ */
+static void
+xvShiftLine(vs, row)
+VirtScr		*vs;
+int		row;
+{
+    Sline		*new;
+    Sline		*real;
+    int			columns;
+    int			n_used;
+    int			r_used;
+    int			first;		/* first column that differs */
+    int			best_cost;
+    int			best_n;		/* chars to insert; -ve to delete */
+    register int	n;
+
+    columns = VScols(vs);
+    new = vs->pv_int_lines + row;
+    real = vs->pv_ext_lines + row;
+    n_used = new->s_used;
+    r_used = real->s_used;
+
+    for (first = 0; first < n_used && first < r_used; first++) {
+	if (new->s_line[first] != real->s_line[first] ||
+			    new->s_colour[first] != real->s_colour[first]) {
+	    break;
+	}
+    }
+    if (first >= n_used || first >= r_used) {
+	return;
+    }
+
+    best_cost = xvShiftCost(new, real, first, 0, columns);
+    best_n = 0;
+
+    for (n = 1; n <= SHIFT_MAX; n++) {
+	int	cost;
+	int	i;
+
+	/*
+	 * Would inserting n characters at the first difference
+	 * bring the rest of the row into line? The characters
+	 * inserted must all be the same colour.
+	 */
+	if (vs->v_insert != NOFUNC && first + n < n_used &&
+		    new->s_line[first + n] == real->s_line[first] &&
+		    new->s_colour[first + n] == real->s_colour[first]) {
+	    for (i = 1; i < n; i++) {
+		if (new->s_colour[first + i] != new->s_colour[first]) {
+		    break;
+		}
+	    }
+	    if (i >= n && (cost = VSinsdel_cost(vs, n)) != 0) {
+		if (cost == 1) {
+		    cost = n * CHAR_COST;
+		}
+		cost += xvShiftCost(new, real, first + n, n, columns);
+		if (cost < best_cost) {
+		    best_cost = cost;
+		    best_n = n;
+		}
+	    }
+	}
+
+	/*
+	 * Or deleting n characters there?
+	 */
+	if (vs->v_delete != NOFUNC && first + n < r_used &&
+		    real->s_line[first + n] == new->s_line[first] &&
+		    real->s_colour[first + n] == new->s_colour[first] &&
+		    (cost = VSinsdel_cost(vs, -n)) != 0) {
+	    if (cost == 1) {
+		cost = n * CHAR_COST;
+	    }
+	    cost += xvShiftCost(new, real, first, -n, columns);
+	    if (cost < best_cost) {
+		best_cost = cost;
+		best_n = -n;
+	    }
+	}
+    }
+
+    if (best_n > 0) {
+	char	buf[SHIFT_MAX + 1];
+	int	nmove;
+
+	n = best_n;
+	(void) memcpy(buf, new->s_line + first, n);
+	buf[n] = '\0';
+	VSset_colour(vs, new->s_colour[first]);
+	VSinsert(vs, row, first, buf);
+	VSset_colour(vs, VSCcolour);
+
+	/*
+	 * Characters pushed past the last column are lost.
+	 */
+	nmove = ((r_used < columns - n) ? r_used : columns - n) - first;
+	(void) memmove(real->s_line + first + n, real->s_line + first, nmove);
+	(void) memmove(real->s_colour + first + n, real->s_colour + first,
+							    nmove);
+	(void) memcpy(real->s_line + first, new->s_line + first, n);
+	(void) memcpy(real->s_colour + first, new->s_colour + first, n);
+	real->s_used = first + n + nmove;
+    } else if (best_n < 0) {
+	n = -best_n;
+	VSset_colour(vs, VSCcolour);
+	VSdelete(vs, row, first, n);
+
+	(void) memmove(real->s_line + first, real->s_line + first + n,
+						    r_used - first - n);
+	(void) memmove(real->s_colour + first, real->s_colour + first + n,
+						    r_used - first - n);
+	real->s_used = r_used - n;
+    } else {
+	return;
+    }
+    real->s_line[real->s_used] = '\0';
+}
+
+/*
+ * Return the approximate number of bytes needed to update the new
+ * row from column "start" onwards, if the real one had first been
+ * shifted right by "shift" columns (left, if negative).
+ */
+static int
+xvShiftCost(new, real, start, shift, columns)
+Sline		*new;
+Sline		*real;
+int		start;
+int		shift;
+int		columns;
+{
+    register int	col;
+    register int	cost;
+    int			n_used;
+    int			r_used;
+    int			gap;		/* unchanged columns since last change */
+
+    n_used = new->s_used;
+    r_used = real->s_used + shift;
+    if (r_used > columns) {
+	r_used = columns;
+    }
+
+    /*
+     * The cursor is already at the start column. Unchanged
+     * characters between changed ones are either moved over or
+     * written again, whichever is cheaper.
+     */
+    cost = 0;
+    gap = 0;
+    for (col = start; col < n_used; col++) {
+	if (col >= r_used ||
+		    new->s_line[col] != real->s_line[col - shift] ||
+		    new->s_colour[col] != real->s_colour[col - shift]) {
+	    cost += 1 + ((gap < MOVE_COST) ? gap : MOVE_COST);
+	    gap = 0;
+	} else {
+	    gap++;
+	}
+    }
+    if (r_used > n_used) {
+	cost += CLEAR_COST;
+    }
+    return(cost);
+}
+
 /*
  * Write a string containing multiple coloured sections at the given
  * location. The colours are given by the byte array "colours".
@@ -204,7 +204,7 @@ Cmd	*cmd;
 	break;
 
     case '@':
-	yp_stuff_input(cmd->cmd_ch2, TRUE, TRUE);
+	yp_replay(cmd->cmd_ch2, IDEF1(cmd->cmd_prenum));
 	break;
 
     /*
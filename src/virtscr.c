@@ -232,3 +232,36 @@ char	*colstr;
     vs->pv_colours[which] = i;
     return(TRUE);
 }
+
+/*
+ * Produce the lines shown by the ":outstats" command, one per call.
+ */
+static	VirtScr	*statvs;
+static	int	statline;
+
+static char *
+vs_statline()
+{
+    return(VSstats(statvs, statline++));
+}
+
+/*
+ * Show how much output the screen has done, for the ":outstats"
+ * command; ":outstats!" resets the counts instead.
+ */
+void
+vs_stats(vs, reset)
+VirtScr	*vs;
+bool_t	reset;
+{
+    if (vs->v_stats == NOFUNC) {
+	show_error("No output statistics for this screen");
+    } else if (reset) {
+	(void) VSstats(vs, -1);
+	show_message("Output statistics reset");
+    } else {
+	statvs = vs;
+	statline = 0;
+	disp_init(vs_statline, (int) curwin->w_ncols, FALSE);
+    }
+}
@@ -90,8 +90,27 @@ typedef struct virtscr {
 
     int		(*v_scroll) P((struct virtscr *, int, int, int));
 
+    /*
+     * Returns 0 if v_scroll would fail; otherwise it may return an
+     * estimate of the number of bytes the scroll would take, or 1.
+     */
     int		(*v_can_scroll) P((struct virtscr *, int, int, int));
 
+    void	(*v_delete) P((struct virtscr *, int, int, int));
+
+    /*
+     * Returns 0 if v_insert (for a positive count) or v_delete
+     * (for a negative one) can't be used; otherwise it returns an
+     * estimate of the number of bytes it would take.
+     */
+    int		(*v_insdel_cost) P((struct virtscr *, int));
+
+    /*
+     * Returns line n of a description of the output done so far,
+     * or NULL after the last line; a negative n resets the counts.
+     */
+    char	*(*v_stats) P((struct virtscr *, int));
+
 } VirtScr;
 
 #define	VSrows(vs)			(vs->pv_rows)
@@ -117,6 +136,14 @@ typedef struct virtscr {
 				    (*(vs->v_can_scroll))(vs, start, end, n) : \
 				    (vs->v_scroll != NULL) \
 			    )
+#define	VSdelete(vs, row, col, n)	((*(vs->v_delete))(vs, row, col, n))
+#define	VSstats(vs, n)			((*(vs->v_stats))(vs, n))
+#define	VSinsdel_cost(vs, n)		(\
+				(vs->v_insdel_cost != NULL) ? \
+				    (*(vs->v_insdel_cost))(vs, n) : \
+				    ((n) > 0 ? vs->v_insert != NULL : \
+					       vs->v_delete != NULL) \
+			    )
 
 /*
  * Editor input events are of type xvEvent.
@@ -124,12 +151,14 @@ typedef struct virtscr {
 typedef struct xvevent {
     enum {
 	Ev_char,
+	Ev_chars,			/* several characters at once */
 	Ev_timeout,
 	Ev_refresh,
 	Ev_resize,
 	Ev_mouseclick,
 	Ev_mousedrag,
 	Ev_mousemove,
+	Ev_paste,			/* a block of text pasted all at once */
 	Ev_breakin,			/* stop, I didn't mean that! I said stop! */
 	Ev_suspend_request,		/* hold it, I want to do something else */
 	Ev_terminate,			/* please just go away now */
@@ -142,6 +171,12 @@ typedef struct xvevent {
 	/* Ev_char: */
 	int	evu_inchar;
 
+	/* Ev_chars: */
+	struct {
+	    char     *evuc_chars;
+	    int	     evuc_nchars;
+	} evu_c;
+
 	/* Ev_timeout: */
 
 	/* Ev_reresh: */
@@ -162,10 +197,15 @@ typedef struct xvevent {
 	    int	     evum_endrow;
 	    int      evum_endcol;
 	} evu_m;
+
+	/* Ev_paste: */
+	char	*evu_paste;
     }			ev_u;
 } xvEvent;
 
 #define	ev_inchar	ev_u.evu_inchar
+#define	ev_chars	ev_u.evu_c.evuc_chars
+#define	ev_nchars	ev_u.evu_c.evuc_nchars
 #define	ev_do_clear	ev_u.evu_do_clear
 #define	ev_rows		ev_u.evu_r.evur_rows
 #define	ev_columns	ev_u.evu_r.evur_columns
@@ -173,6 +213,7 @@ typedef struct xvevent {
 #define	ev_m_col	ev_u.evu_m.evum_col
 #define	ev_m_endrow	ev_u.evu_m.evum_endrow
 #define	ev_m_endcol	ev_u.evu_m.evum_endcol
+#define	ev_paste	ev_u.evu_paste
 
 /*
  * The editor responds to an event with one of these:
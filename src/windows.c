@@ -195,6 +195,8 @@ Buffer	*b;
     w->w_cursor->p_index = 0;
     w->w_topline = b->b_file;
     w->w_botline = b->b_lastline;
+    w->w_skiprows = 0;
+    w->w_leftcol = 0;
 
     /*
      * Miscellany.
@@ -235,6 +235,13 @@ typedef	int		bool_t;
 #define	NUM_SIZE	8
 #define	NUM_FMT		"%6ld  "
 
+/*
+ * All the parameters which affect how the text of a line is displayed.
+ * Information cached with a line is only valid while this is unchanged.
+ */
+#define	CELLKEY()	((Pn(P_tabstop) << 4) | (Pb(P_tabs) << 3) | \
+			 (Pb(P_list) << 2) | (Pb(P_cchars) << 1) | Pb(P_mchars))
+
 /*
  * Maximum value for the tabstop parameter.
  */
@@ -385,6 +392,11 @@ typedef	struct	line {
     char		*l_text;	/* text for this line */
     int			l_size;		/* actual size of space at 's' */
     unsigned long	l_number;	/* line "number" */
+    unsigned long	l_version;	/* incremented when text changes */
+    struct linecells	*l_cells;	/* cached display form, or NULL */
+    struct linecols	*l_cols;	/* column checkpoints, or NULL */
+    struct line		*l_tnext;	/* next line sharing l_text, or NULL */
+    struct line		*l_tprev;	/* previous line sharing l_text, or NULL */
 } Line;
 
 #define	MAX_LINENO	ULONG_MAX
@@ -559,6 +571,8 @@ typedef struct xviwin {
 
     Line		*w_topline;	/* line at top of screen */
     Line		*w_botline;	/* line below bottom of screen */
+    long		w_skiprows;	/* rows of w_topline above window */
+    int			w_leftcol;	/* first column shown if nowrap */
 
     VirtScr		*w_vs;		/* virtual screen for window */
 
@@ -617,7 +631,6 @@ typedef struct xviwin {
 #define	SPARE_COLS	1
 
 typedef struct tag {
-    struct tag	*t_next;
     char	*t_name;
     char	*t_file;
     char	*t_locator;
@@ -723,6 +736,14 @@ extern volatile int	keystrokes;
     no system-specific include file found
 #endif
 
+/*
+ * Systems which can tell whether more keyboard input has already
+ * arrived provide kbpending(); for the others, we never know.
+ */
+#ifndef	HAVE_KBPENDING
+#   define	kbpending()	FALSE
+#endif
+
 
 /***************************************************************
  *                                                             *
@@ -872,11 +893,13 @@ extern	void	*clr_alloc P((size_t, size_t));
 extern	char	*strsave P((const char *));
 extern	Line	*newline P((int));
 extern	Line	*snewline P((char *));
+extern	Line	*twinline P((Line *));
+extern	bool_t	own_text P((Line *));
 extern	bool_t	lnresize P((Line *, unsigned));
 extern	bool_t	bufempty P((void));
 extern	bool_t	buf1line P((Buffer *));
 extern	bool_t	endofline P((Posn *));
-extern	bool_t	grow_line P((Line *, int));
+extern	bool_t	grow_line P((Line *, int, int));
 extern	void	throw P((Line *));
 
 /*
@@ -930,6 +953,10 @@ extern	void	do_ins P((Cmd *));
  * cursor.c
  */
 extern	void	cursupdate P((void));
+extern	void	colschanged P((Line *, int));
+extern	int	colindex P((Line *, int, int *));
+extern	int	cursorcol P((Posn *));
+extern	long	linerow P((Posn *));
 
 /*
  * defscr.c
@@ -948,6 +975,7 @@ extern	void	prompt P((char *));
  */
 extern	bool_t	i_proc P((int));
 extern	bool_t	r_proc P((int));
+extern	void	i_paste P((char *));
 extern	void	startinsert P((bool_t, int));
 extern	void	startreplace P((Cmd *));
 extern	char	*mkstr P((int));
@@ -1034,10 +1062,15 @@ extern	bool_t	lformat P((Flexbuf *, char *, ...));
 extern	void	stuff P((char *, ...));
 extern	void	stuff_to_map P((char *));
 extern	void	unstuff P((void));
+extern	bool_t	map_replay P((char *, long));
+extern	bool_t	map_replaying P((void));
+extern	void	map_endreplay P((void));
 extern	int	map_getc P((void));
 extern	void	map_char P((int));
 extern	void	map_timeout P((void));
 extern	bool_t	map_waiting P((void));
+extern	bool_t	map_pending P((void));
+extern	long	map_waittime P((void));
 extern	int	mapped_char P((int));
 extern	bool_t	xvi_map P((char *, bool_t));
 extern	void	xvi_keymap P((char *, char *));
@@ -1053,6 +1086,11 @@ extern	Posn	*getmark P((int, Buffer *));
 extern	void	clrmark P((Line *, Buffer *));
 extern	void	restoremarks P((Line *, Buffer *));
 
+/*
+ * memscr.c
+ */
+extern	void	memscr_main P((int, char **));
+
 /*
  * misccmds.c
  */
@@ -1158,12 +1196,15 @@ extern	void	update_sline P((void));
 extern	void	update_cline P((void));
 extern	void	redraw_window P((bool_t));
 extern	void	redraw_all P((bool_t));
+extern	void	redraw_deferred P((void));
 extern	void	s_ins P((int, int));
 extern	void	s_del P((int, int));
 extern	void	s_inschar P((int));
 extern	void	wind_goto P((void));
 extern	void	gotocmd P((bool_t));
 extern	void	beep P((void));
+extern	int	line_width P((Line *));
+extern	void	cells_replaced P((Line *, int, int, char *));
 
 /*
  * search.c
@@ -1200,10 +1241,12 @@ extern	void	info_update P((void));
  * tags.c
  */
 extern	void	tagInit P((void));
+extern	void	tagCheckLoad P((void));
 extern	void	tagword P((void));
 extern	bool_t	exTag P((char *, bool_t, bool_t, bool_t));
 extern	TAG	*tagLookup P((char *, int *, int *));
 extern	bool_t	tagSetParam P((Paramval, bool_t));
+extern	void	tagStats P((void));
 
 /*
  * targets.c
@@ -1223,6 +1266,7 @@ extern	bool_t	start_command P((Cmd *));
 extern	void	end_command P((void));
 extern	void	replchars P((Line *, int, int, char *));
 extern	void	repllines P((Line *, long, Line *));
+extern	void	movelines P((Line *, Line *, Line *));
 extern	void	replbuffer P((Line *));
 extern	void	undo P((void));
 extern	void	undoline P((void));
@@ -1242,6 +1286,7 @@ extern	bool_t	vs_init P((VirtScr *));
 extern	bool_t	vs_resize P((VirtScr *, int, int));
 extern	void	vs_free P((VirtScr *));
 extern	int	xv_decode_colour P((VirtScr *, int, char *));
+extern	void	vs_stats P((VirtScr *, bool_t));
 
 /*
  * windows.c
@@ -1270,4 +1315,6 @@ extern	bool_t	do_yank P((Posn *, Posn *, bool_t, int));
 extern	bool_t	yank_str P((int, char *, bool_t));
 extern	void	do_put P((Posn *, int, int, Cmd *));
 extern	void	yp_stuff_input P((int, bool_t, bool_t));
+extern	void	yp_replay P((int, long));
+extern	Line	*copy_lines P((Line *, Line *));
 extern	void	yp_push_deleted P((void));
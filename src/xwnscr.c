@@ -94,6 +94,9 @@ VirtScr	xwnscr = {
     NOFUNC,		/* v_insert	    */
     xw_scroll,		/* v_scroll	    */
     NOFUNC,		/* v_can_scroll	    */
+    NOFUNC,		/* v_delete	    */
+    NOFUNC,		/* v_insdel_cost    */
+    NOFUNC,		/* v_stats	    */
 };
 
 static VirtScr *
@@ -47,6 +47,15 @@ typedef struct yankbuffer {
     char	*y_1st_text;
     char	*y_2nd_text;
     Line	*y_line_buf;
+
+    /*
+     * Several buffers may hold the same text, as when a yank into a named
+     * buffer is also put into the unnamed one. They then have the same
+     * pointers, and y_refs points to a count of how many of them there
+     * are; it is NULL for a buffer whose text is its own. Text which is
+     * shared is copied only when one of the buffers is appended to.
+     */
+    int		*y_refs;
 } Yankbuffer;
 
 /*
@@ -76,11 +85,12 @@ static	Yankbuffer	yb[NBUFS];
 static	void		put P((char *, bool_t, bool_t, bool_t));
 static	Yankbuffer	*yp_get_buffer P((int));
 static	int		bufno P((int));
-static	Line		*copy_lines P((Line *, Line *));
 static	char		*yanktext P((Posn *, Posn *));
 static	void		yp_free P((Yankbuffer *));
+static	bool_t		yp_share P((Yankbuffer *, Yankbuffer *));
+static	bool_t		yp_unshare P((Yankbuffer *));
 static	bool_t		yp_chars_to_lines P((Yankbuffer *));
-static	void		yp_lines_to_chars P((Yankbuffer *));
+static	bool_t		yp_lines_to_chars P((Yankbuffer *));
 static	Line *		last_line_of P((Line *lp));
 static	bool_t		append_str_to_lines P((Line **, char *));
 
@@ -134,7 +144,6 @@ int name;
     case '?':
     case '@':
     case '<':
-    case '=': /* Secret buffer used by copy/move in exLineOperation() */
 		break;
 
     case ';':	/* Invalid names that are in range */
@@ -204,6 +213,8 @@ int	name;
 
     if (!append) {
 	yp_free(yp_buf);
+    } else if (!yp_unshare(yp_buf)) {
+	return(FALSE);
     }
 
     if (charbased) {
@@ -276,37 +287,7 @@ Yankbuffer	*yp_buf;
     Yankbuffer*	atp = &yb[bufno('@')];
 
     yp_free(atp);
-
-    atp->y_type = yp_buf->y_type;
-
-    if (yp_buf->y_1st_text != NULL) {
-	if ((atp->y_1st_text = strsave(yp_buf->y_1st_text)) == NULL) {
-	    goto oom1;
-	}
-	if (yp_buf->y_2nd_text != NULL) {
-	    atp->y_2nd_text = strsave(yp_buf->y_2nd_text);
-	    if (atp->y_2nd_text == NULL) {
-		goto oom2;
-	    }
-	}
-    }
-    if (yp_buf->y_line_buf != NULL) {
-	atp->y_line_buf = copy_lines(yp_buf->y_line_buf, (Line *) NULL);
-	if (atp->y_line_buf == NULL) {
-	    goto oom3;
-	}
-    }
-    return(TRUE);
-
-    /* Out-of-memory handlers */
-oom3:
-    free(atp->y_2nd_text);
-    atp->y_2nd_text = NULL;
-oom2:
-    free(atp->y_1st_text);
-    atp->y_1st_text = NULL;
-oom1:
-    return(FALSE);
+    return(yp_share(atp, yp_buf));
 }
 
 /*
@@ -392,8 +373,8 @@ append_chars_to_yp_buf(old, new)
 Yankbuffer *old;
 Yankbuffer *new;
 {
-    if (old->y_type == y_lines) {
-	yp_lines_to_chars(old);
+    if (old->y_type == y_lines && !yp_lines_to_chars(old)) {
+	return(FALSE);
     }
 
     /*
@@ -831,6 +812,71 @@ bool_t	map_it;
     }
 }
 
+/*
+ * Execute the specified buffer count times, for a counted '@' command.
+ *
+ * Rather than stuffing count copies of the buffer into the input, we
+ * flatten it into a single string once, and map_replay() feeds that
+ * into the input as often as needed. If it can't, because other input
+ * has been stuffed already (as when one macro calls another), we fall
+ * back to stuffing the copies.
+ */
+void
+yp_replay(name, count)
+int	name;
+long	count;
+{
+    Yankbuffer	*yp_buf;
+    Line	*lp;
+    Flexbuf	text;
+    bool_t	ok;
+
+    if (count <= 1) {
+	yp_stuff_input(name, TRUE, TRUE);
+	return;
+    }
+
+    yp_buf = yp_get_buffer(name);
+    if (yp_buf == NULL) {
+	return;
+    }
+
+    flexnew(&text);
+    ok = TRUE;
+    switch (yp_buf->y_type) {
+    case y_chars:
+	if (yp_buf->y_1st_text != NULL) {
+	    ok = lformat(&text, "%s", yp_buf->y_1st_text);
+	}
+	if (yp_buf->y_2nd_text != NULL) {
+	    ok = ok && flexaddch(&text, '\n');
+	}
+	break;
+
+    case y_lines:
+	break;
+
+    default:
+	show_error("Nothing to put!");
+	return;
+    }
+
+    for (lp = yp_buf->y_line_buf; ok && lp != NULL; lp = lp->l_next) {
+	ok = lformat(&text, "%s\n", lp->l_text);
+    }
+
+    if (ok && yp_buf->y_type == y_chars && yp_buf->y_2nd_text != NULL) {
+	ok = lformat(&text, "%s", yp_buf->y_2nd_text);
+    }
+
+    if (!ok || !map_replay(flexgetstr(&text), count)) {
+	while (count-- > 0 && !kbdintr) {
+	    yp_stuff_input(name, TRUE, TRUE);
+	}
+    }
+    flexdelete(&text);
+}
+
 /*
  * Stuff a string into the input.
  *
@@ -869,12 +915,13 @@ bool_t	map_it;
 
 /*
  * Copy the lines pointed at by "from", up to but not including
- * pointer "to" (which might be NULL), into new memory and return
- * a pointer to the start of the new list.
+ * pointer "to" (which might be NULL), and return a pointer to the
+ * start of the new list. The new lines share their text with the
+ * old ones until one or the other is changed.
  *
  * Returns NULL for errors.
  */
-static Line *
+Line *
 copy_lines(from, to)
 Line	*from, *to;
 {
@@ -887,18 +934,12 @@ Line	*from, *to;
     for (src = from; src != to; src = src->l_next) {
 	Line	*tmp;
 
-	tmp = newline(strlen(src->l_text) + 1);
+	tmp = twinline(src);
 	if (tmp == NULL) {
 	    throw(head.l_next);
 	    return(NULL);
 	}
 
-	/*
-	 * Copy the line's text over, and advance
-	 * "dest" to point to the new line structure.
-	 */
-	(void) strcpy(tmp->l_text, src->l_text);
-	tmp->l_next = NULL;
 	tmp->l_prev = dest;
 	dest->l_next = tmp;
 	dest = tmp;
@@ -930,6 +971,21 @@ static void
 yp_free(yp)
 Yankbuffer	*yp;
 {
+    if (yp->y_refs != NULL) {
+	/*
+	 * If another buffer still has the text, just forget it.
+	 */
+	if (--*(yp->y_refs) > 0) {
+	    yp->y_refs = NULL;
+	    yp->y_1st_text = yp->y_2nd_text = NULL;
+	    yp->y_line_buf = NULL;
+	    yp->y_type = y_none;
+	    return;
+	}
+	free((genptr *) yp->y_refs);
+	yp->y_refs = NULL;
+    }
+
     switch (yp->y_type) {
     case y_chars:
 	free(yp->y_1st_text);
@@ -965,6 +1021,84 @@ yp_push_deleted()
     atp->y_line_buf = NULL;
     atp->y_1st_text = NULL;
     atp->y_2nd_text = NULL;
+    atp->y_refs = NULL;
+}
+
+/*
+ * Make the empty buffer "to" hold the same text as "from", without
+ * copying it.
+ */
+static bool_t
+yp_share(to, from)
+Yankbuffer	*to;
+Yankbuffer	*from;
+{
+    if (from->y_type != y_none && from->y_refs == NULL) {
+	from->y_refs = (int *) malloc(sizeof(int));
+	if (from->y_refs == NULL) {
+	    return(FALSE);
+	}
+	*(from->y_refs) = 1;
+    }
+    *to = *from;
+    if (to->y_refs != NULL) {
+	++*(to->y_refs);
+    }
+    return(TRUE);
+}
+
+/*
+ * Give the buffer a copy of its text of its own, if it is sharing it
+ * with any other buffers, so that it can be changed.
+ */
+static bool_t
+yp_unshare(yp)
+Yankbuffer	*yp;
+{
+    Yankbuffer	copy;
+
+    if (yp->y_refs == NULL) {
+	return(TRUE);
+    }
+    if (*(yp->y_refs) == 1) {
+	free((genptr *) yp->y_refs);
+	yp->y_refs = NULL;
+	return(TRUE);
+    }
+
+    copy.y_type = yp->y_type;
+    copy.y_1st_text = copy.y_2nd_text = NULL;
+    copy.y_line_buf = NULL;
+    copy.y_refs = NULL;
+
+    if (yp->y_1st_text != NULL) {
+	if ((copy.y_1st_text = strsave(yp->y_1st_text)) == NULL) {
+	    goto oom1;
+	}
+	if (yp->y_2nd_text != NULL) {
+	    copy.y_2nd_text = strsave(yp->y_2nd_text);
+	    if (copy.y_2nd_text == NULL) {
+		goto oom2;
+	    }
+	}
+    }
+    if (yp->y_line_buf != NULL) {
+	copy.y_line_buf = copy_lines(yp->y_line_buf, (Line *) NULL);
+	if (copy.y_line_buf == NULL) {
+	    goto oom3;
+	}
+    }
+    --*(yp->y_refs);
+    *yp = copy;
+    return(TRUE);
+
+    /* Out-of-memory handlers */
+oom3:
+    free(copy.y_2nd_text);
+oom2:
+    free(copy.y_1st_text);
+oom1:
+    return(FALSE);
 }
 
 /*
@@ -1028,12 +1162,20 @@ Yankbuffer	*yp;
  *
  * A char buffer may be just 1st_text, just 1st_ and 2nd_text or all three,
  * so we need to split off the first and last lines of the line buffer into those.
+ *
+ * Returns FALSE if there is no memory.
  */
-static void
+static bool_t
 yp_lines_to_chars(yp)
 Yankbuffer	*yp;
 {
     Line *lp = yp->y_line_buf;	/* First line */
+    Line *last = last_line_of(lp);
+
+    /* The texts are about to be taken, so they must not be shared */
+    if (!own_text(lp) || !own_text(last)) {
+	return(FALSE);
+    }
 
     /* Split of first line's text into y_1st_text */
     yp->y_1st_text = lp->l_text;
@@ -1059,6 +1201,7 @@ Yankbuffer	*yp;
     }
 
     yp->y_type = y_chars;
+    return(TRUE);
 }
 
 /*